@@ -26,11 +26,52 @@
 
 #include "linux-adk.h"
 #include "hid.h"
+#include "filexfer.h"
+#include "mux.h"
+#include "ping.h"
+#include "pool.h"
 
 void accessory_main(accessory_t * acc)
 {
+	/* Round-trip latency probe */
+	if (acc->ping_count) {
+		ping_accessory(acc);
+		return;
+	}
+
+	/* Virtual channel benchmark */
+	if (acc->mux_channels > 0) {
+		mux_bench(acc);
+		return;
+	}
+
+	/* The remaining modes run on this thread only */
+	pool_seal();
+
+	if (acc->simulate) {
+		printf("Only --ping and --mux-bench can run against the "
+		       "simulated device\n");
+		return;
+	}
+
+	/* File transfer over the bulk endpoints */
+	if (acc->push_file) {
+		push_file(acc, acc->push_file);
+		return;
+	}
+	if (acc->pull_file) {
+		pull_file(acc, acc->pull_file);
+		return;
+	}
+
 	/* HID support */
 	if (acc->pid >= AOA_AUDIO_PID) {
+		if (acc->gamepad) {
+			send_gamepad_descriptor(acc);
+			sleep(1);
+			send_gamepad_inputs(acc);
+			return;
+		}
         send_hid_descriptor(acc);
         sleep(1);
         send_hid_inputs(acc);
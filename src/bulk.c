@@ -0,0 +1,249 @@
+/*
+ * Linux ADK - bulk.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <libusb.h>
+
+#include "linux-adk.h"
+#include "bulk.h"
+#include "simdev.h"
+#include "pool.h"
+
+/* Bursts (max size packets below SuperSpeed) per transfer, and queue depth */
+static const struct bulk_profile {
+	int speed;
+	const char *name;
+	int bursts;
+	int depth;
+} bulk_profiles[] = {
+	{ LIBUSB_SPEED_FULL, "full speed", 256, 2 },
+	{ LIBUSB_SPEED_HIGH, "high speed", 128, 4 },
+	{ LIBUSB_SPEED_SUPER, "SuperSpeed", 64, 8 },
+	{ LIBUSB_SPEED_SUPER_PLUS, "SuperSpeed+", 32, 16 },
+};
+
+/* Smallest bMaxBurst + 1 of the accessory bulk endpoints, 1 below USB 3 */
+static int bulk_max_burst(libusb_device *dev)
+{
+	const struct libusb_interface_descriptor *as;
+	struct libusb_config_descriptor *config;
+	struct libusb_ss_endpoint_companion_descriptor *ep_comp;
+	int burst = 0;
+	int i;
+
+	if (libusb_get_active_config_descriptor(dev, &config) < 0)
+		return 1;
+	if (config->bNumInterfaces <= AOA_ACCESSORY_INTERFACE)
+		goto end;
+
+	as = &config->interface[AOA_ACCESSORY_INTERFACE].altsetting[0];
+	for (i = 0; i < as->bNumEndpoints; i++) {
+		const struct libusb_endpoint_descriptor *ep = &as->endpoint[i];
+
+		if ((ep->bEndpointAddress != AOA_ACCESSORY_EP_IN)
+		    && (ep->bEndpointAddress != AOA_ACCESSORY_EP_OUT))
+			continue;
+		if (libusb_get_ss_endpoint_companion_descriptor(NULL, ep,
+								&ep_comp) < 0)
+			continue;
+		if (!burst || (ep_comp->bMaxBurst + 1 < burst))
+			burst = ep_comp->bMaxBurst + 1;
+		libusb_free_ss_endpoint_companion_descriptor(ep_comp);
+	}
+
+end:
+	libusb_free_config_descriptor(config);
+	return burst ? burst : 1;
+}
+
+/*
+ * Size transfers to a whole number of bursts, large enough to amortize
+ * the per-transfer overhead at the link rate, and queue enough of them
+ * that the host controller does not run dry between completions.
+ */
+static void bulk_tune(accessory_t *acc)
+{
+	libusb_device *dev = libusb_get_device(acc->handle);
+	const struct bulk_profile *prof = NULL;
+	int speed = libusb_get_device_speed(dev);
+	int burst = bulk_max_burst(dev);
+	int chunk = acc->max_packet * burst;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LEN(bulk_profiles); i++)
+		if (bulk_profiles[i].speed == speed)
+			prof = &bulk_profiles[i];
+	if (prof == NULL) {
+		printf("Unknown link speed, using default bulk parameters\n");
+		return;
+	}
+
+	if (acc->queue_depth <= 0)
+		acc->queue_depth = prof->depth;
+	if (acc->xfer_size <= 0) {
+		int max = BULK_MAX_INFLIGHT / acc->queue_depth;
+
+		if (max > BULK_MAX_XFER_SIZE)
+			max = BULK_MAX_XFER_SIZE;
+		acc->xfer_size = chunk * prof->bursts;
+		if (acc->xfer_size > max)
+			acc->xfer_size = max / chunk * chunk;
+		if (acc->xfer_size < chunk)
+			acc->xfer_size = chunk;
+	}
+
+	printf("Bulk link: %s, wMaxPacketSize %d x burst %d, %d KiB "
+	       "transfers, %d in flight\n", prof->name, acc->max_packet, burst,
+	       acc->xfer_size / 1024, acc->queue_depth);
+}
+
+int bulk_open(accessory_t *acc)
+{
+	int ret;
+
+	if (acc->bulk_claimed)
+		return 0;
+
+	if (acc->sim)
+		goto defaults;
+
+	/* Only the accessory PIDs expose the bulk interface */
+	if ((acc->pid != AOA_ACCESSORY_PID)
+	    && (acc->pid != AOA_ACCESSORY_ADB_PID)
+	    && (acc->pid != AOA_ACCESSORY_AUDIO_PID)
+	    && (acc->pid != AOA_ACCESSORY_AUDIO_ADB_PID)) {
+		printf("Device %4.4x:%4.4x has no accessory interface\n",
+		       acc->vid, acc->pid);
+		return -1;
+	}
+
+	ret = libusb_claim_interface(acc->handle, AOA_ACCESSORY_INTERFACE);
+	if (ret < 0) {
+		printf("Error %d claiming interface...\n", ret);
+		return ret;
+	}
+	acc->bulk_claimed = 1;
+
+	acc->max_packet =
+	    libusb_get_max_packet_size(libusb_get_device(acc->handle),
+				       AOA_ACCESSORY_EP_OUT);
+	if (acc->max_packet <= 0)
+		acc->max_packet = BULK_DEFAULT_MAX_PACKET;
+	bulk_tune(acc);
+
+defaults:
+	if (acc->max_packet <= 0)
+		acc->max_packet = BULK_DEFAULT_MAX_PACKET;
+	if (acc->xfer_size <= 0)
+		acc->xfer_size = BULK_DEFAULT_XFER_SIZE;
+	if (acc->queue_depth <= 0)
+		acc->queue_depth = BULK_DEFAULT_QUEUE_DEPTH;
+	if (acc->queue_depth > BULK_MAX_QUEUE_DEPTH)
+		acc->queue_depth = BULK_MAX_QUEUE_DEPTH;
+
+	return 0;
+}
+
+void bulk_close(accessory_t *acc)
+{
+	if (!acc->bulk_claimed)
+		return;
+
+	libusb_release_interface(acc->handle, AOA_ACCESSORY_INTERFACE);
+	acc->bulk_claimed = 0;
+}
+
+static void LIBUSB_CALL bulk_cb(struct libusb_transfer *t)
+{
+	*(int *)t->user_data = 1;
+}
+
+/* Blocking bulk transfer on a pooled transfer, so it does not allocate */
+static int bulk_sync(accessory_t *acc, unsigned char endpoint,
+		     unsigned char *buf, int len, unsigned int timeout)
+{
+	struct libusb_transfer *t;
+	int done = 0;
+	int ret;
+
+	t = pool_get(&transfer_pool);
+	if (t == NULL)
+		return LIBUSB_ERROR_NO_MEM;
+
+	libusb_fill_bulk_transfer(t, acc->handle, endpoint, buf, len, bulk_cb,
+				  &done, timeout);
+	/* A write filling whole packets needs a ZLP to end the transfer */
+	t->flags = (endpoint == AOA_ACCESSORY_EP_OUT) ?
+		   LIBUSB_TRANSFER_ADD_ZERO_PACKET : 0;
+	ret = libusb_submit_transfer(t);
+	if (ret < 0)
+		goto end;
+	while (!done)
+		libusb_handle_events_completed(NULL, &done);
+
+	switch (t->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		ret = t->actual_length;
+		break;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		/* Whatever arrived before the timeout must not be lost */
+		ret = t->actual_length ? t->actual_length :
+		    LIBUSB_ERROR_TIMEOUT;
+		break;
+	case LIBUSB_TRANSFER_STALL:
+		ret = LIBUSB_ERROR_PIPE;
+		break;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		ret = LIBUSB_ERROR_OVERFLOW;
+		break;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		ret = LIBUSB_ERROR_NO_DEVICE;
+		break;
+	default:
+		ret = LIBUSB_ERROR_IO;
+		break;
+	}
+
+end:
+	t->flags = 0;
+	pool_put(&transfer_pool, t);
+	return ret;
+}
+
+int bulk_write(accessory_t *acc, const void *buf, int len,
+	       unsigned int timeout)
+{
+	if (acc->sim)
+		return sim_write(acc->sim, buf, len);
+
+	return bulk_sync(acc, AOA_ACCESSORY_EP_OUT, (unsigned char *)buf, len,
+			 timeout);
+}
+
+int bulk_read(accessory_t *acc, void *buf, int len, unsigned int timeout)
+{
+	if (acc->sim)
+		return sim_read(acc->sim, buf, len, timeout);
+
+	return bulk_sync(acc, AOA_ACCESSORY_EP_IN, buf, len, timeout);
+}
@@ -0,0 +1,49 @@
+/*
+ * Linux ADK - bulk.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _BULK_H_
+#define _BULK_H_
+
+/* Default bulk transfer parameters */
+#define BULK_DEFAULT_XFER_SIZE		(64 * 1024)
+#define BULK_DEFAULT_QUEUE_DEPTH	4
+#define BULK_MAX_QUEUE_DEPTH		64
+#define BULK_TIMEOUT			5000	/* ms */
+#define BULK_DEFAULT_MAX_PACKET		512	/* high speed */
+
+/*
+ * Unless set on the command line, transfer size and queue depth follow
+ * the link speed. The transfer pool is sized for the deepest queue, as
+ * the speed is only known after the handshake.
+ */
+#define BULK_MAX_XFER_SIZE		(1024 * 1024)
+/* Stay well inside the default usbfs budget of 16 MiB (usbfs_memory_mb) */
+#define BULK_MAX_INFLIGHT		(8 * 1024 * 1024)
+#define BULK_AUTO_MAX_QUEUE_DEPTH	16
+
+/* Functions */
+extern int bulk_open(accessory_t *acc);
+extern void bulk_close(accessory_t *acc);
+extern int bulk_write(accessory_t *acc, const void *buf, int len,
+		      unsigned int timeout);
+extern int bulk_read(accessory_t *acc, void *buf, int len,
+		     unsigned int timeout);
+
+#endif /* _BULK_H_ */
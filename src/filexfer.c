@@ -0,0 +1,605 @@
+/*
+ * Linux ADK - filexfer.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include <libusb.h>
+
+#include "linux-adk.h"
+#include "bulk.h"
+#include "filexfer.h"
+#include "pool.h"
+#include "util.h"
+
+#ifndef _WIN32
+
+struct xfer_hdr {
+	uint16_t type;
+	uint16_t name_len;
+	uint64_t offset;
+	uint64_t length;
+	uint32_t crc;
+	uint32_t chunk;
+};
+
+/*
+ * Streaming state for one payload. The transfers point straight into the
+ * mapped file, so the payload is never copied in user space.
+ */
+struct xfer_ctx {
+	accessory_t *acc;
+	unsigned char endpoint;
+	unsigned char *base;
+	uint64_t next;		/* next byte to submit */
+	uint64_t end;
+	int chunk;		/* IN: bytes per write on the phone */
+	uint64_t done;		/* bytes completed, in order */
+	uint32_t crc;		/* running CRC of completed IN data */
+	int inflight;
+	int error;
+};
+
+/* CRC-32 (IEEE 802.3), slice-by-8 */
+static uint32_t crc_table[8][256];
+
+static void crc32_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	if (crc_table[0][1])
+		return;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+		crc_table[0][i] = c;
+	}
+	for (i = 0; i < 256; i++)
+		for (j = 1; j < 8; j++)
+			crc_table[j][i] = (crc_table[j - 1][i] >> 8)
+			    ^ crc_table[0][crc_table[j - 1][i] & 0xff];
+}
+
+static uint32_t crc32_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+	crc = ~crc;
+
+	while (len >= 8) {
+		uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16)
+				     | ((uint32_t)p[3] << 24));
+		uint32_t hi = p[4] | (p[5] << 8) | (p[6] << 16)
+		    | ((uint32_t)p[7] << 24);
+
+		crc = crc_table[7][lo & 0xff] ^ crc_table[6][(lo >> 8) & 0xff]
+		    ^ crc_table[5][(lo >> 16) & 0xff] ^ crc_table[4][lo >> 24]
+		    ^ crc_table[3][hi & 0xff] ^ crc_table[2][(hi >> 8) & 0xff]
+		    ^ crc_table[1][(hi >> 16) & 0xff] ^ crc_table[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+	while (len--)
+		crc = crc_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+static int send_hdr(accessory_t *acc, const struct xfer_hdr *hdr,
+		    const char *name)
+{
+	unsigned char buf[XFER_HDR_SIZE + XFER_NAME_MAX];
+	int len = XFER_HDR_SIZE + hdr->name_len;
+	int ret;
+
+	memset(buf, 0, XFER_HDR_SIZE);
+	put_le32(buf, XFER_MAGIC);
+	put_le16(buf + 4, hdr->type);
+	put_le16(buf + 6, hdr->name_len);
+	put_le64(buf + 8, hdr->offset);
+	put_le64(buf + 16, hdr->length);
+	put_le32(buf + 24, hdr->crc);
+	put_le32(buf + 28, hdr->chunk);
+	memcpy(buf + XFER_HDR_SIZE, name, hdr->name_len);
+
+	ret = bulk_write(acc, buf, len, BULK_TIMEOUT);
+	if (ret != len) {
+		printf("Error sending transfer header: %s\n",
+		       ret < 0 ? libusb_error_name(ret) : "short write");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int recv_hdr(accessory_t *acc, struct xfer_hdr *hdr)
+{
+	unsigned char buf[XFER_HDR_SIZE];
+	int ret;
+
+	ret = bulk_read(acc, buf, sizeof(buf), BULK_TIMEOUT);
+	if (ret != sizeof(buf)) {
+		printf("Error receiving transfer header: %s\n",
+		       ret < 0 ? libusb_error_name(ret) : "short read");
+		return -1;
+	}
+	if (get_le32(buf) != XFER_MAGIC) {
+		printf("Invalid transfer header magic\n");
+		return -1;
+	}
+
+	hdr->type = get_le16(buf + 4);
+	hdr->name_len = get_le16(buf + 6);
+	hdr->offset = get_le64(buf + 8);
+	hdr->length = get_le64(buf + 16);
+	hdr->crc = get_le32(buf + 24);
+	hdr->chunk = get_le32(buf + 28);
+
+	if (hdr->type == XFER_ERR) {
+		printf("Transfer refused by the device\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * IN transfer size: one phone write, rounded up with at least one packet
+ * of headroom, so the short packet or ZLP ending the write always ends
+ * the transfer too and writes are never merged.
+ */
+static int xfer_in_size(const struct xfer_ctx *ctx)
+{
+	int mps = ctx->acc->max_packet;
+
+	return (ctx->chunk / mps + 1) * mps;
+}
+
+static int xfer_submit(struct xfer_ctx *ctx, struct libusb_transfer *t)
+{
+	int len, size;
+	int ret;
+
+	if (ctx->next >= ctx->end)
+		return 0;
+
+	if (ctx->endpoint & LIBUSB_ENDPOINT_IN) {
+		/*
+		 * Counted as a whole write even at the end, so that data
+		 * never lands below where it belongs. May run past end, into
+		 * the slack after the mapping.
+		 */
+		len = ctx->chunk;
+		size = xfer_in_size(ctx);
+	} else {
+		len = ctx->acc->xfer_size;
+		if (ctx->end - ctx->next < (uint64_t)len)
+			len = ctx->end - ctx->next;
+		size = len;
+	}
+
+	libusb_fill_bulk_transfer(t, ctx->acc->handle, ctx->endpoint,
+				  ctx->base + ctx->next, size, t->callback,
+				  ctx, BULK_TIMEOUT);
+	ret = libusb_submit_transfer(t);
+	if (ret < 0) {
+		ctx->error = ret;
+		return ret;
+	}
+
+	ctx->next += len;
+	ctx->inflight++;
+	return 0;
+}
+
+static void LIBUSB_CALL xfer_cb(struct libusb_transfer *t)
+{
+	struct xfer_ctx *ctx = t->user_data;
+	uint64_t off = t->buffer - ctx->base;
+
+	ctx->inflight--;
+
+	/*
+	 * Once a transfer has failed, the ones queued behind it must not
+	 * count: done has to stay the end of the contiguous, complete prefix
+	 * that a resumed pull starts after. Once all the data is in, the
+	 * ones left are waiting for writes that will not come.
+	 */
+	if (ctx->error || (ctx->done == ctx->end))
+		return;
+
+	if (t->status != LIBUSB_TRANSFER_COMPLETED) {
+		ctx->error = (t->status == LIBUSB_TRANSFER_TIMED_OUT) ?
+		    LIBUSB_ERROR_TIMEOUT : LIBUSB_ERROR_IO;
+		return;
+	}
+
+	if (!(ctx->endpoint & LIBUSB_ENDPOINT_IN)) {
+		if ((t->actual_length != t->length) || (off != ctx->done)) {
+			ctx->error = LIBUSB_ERROR_IO;
+			return;
+		}
+		ctx->done += t->actual_length;
+		goto next;
+	}
+
+	/*
+	 * After a write shorter than announced, or a lone ZLP, the data of
+	 * the transfers queued behind it lands further than it belongs: move
+	 * it down to the end of the data, and queue the next transfer at the
+	 * matching offset. usbfs copies IN data into the buffer when the
+	 * transfer is reaped, in order, so nothing still queued is clobbered.
+	 */
+	if ((off < ctx->done) || (t->actual_length > ctx->chunk)
+	    || ((uint64_t)t->actual_length > ctx->end - ctx->done)) {
+		ctx->error = LIBUSB_ERROR_OVERFLOW;
+		return;
+	}
+	if (off != ctx->done)
+		memmove(ctx->base + ctx->done, t->buffer, t->actual_length);
+	ctx->next -= ctx->chunk - t->actual_length;
+
+	/* Completions on one endpoint are in order, so CRC can run here */
+	ctx->crc = crc32_update(ctx->crc, ctx->base + ctx->done,
+				t->actual_length);
+	ctx->done += t->actual_length;
+
+next:
+	if (!stop_acc)
+		xfer_submit(ctx, t);
+}
+
+/* Stream [base, base + len) through a queue of acc->queue_depth transfers */
+static int xfer_run(struct xfer_ctx *ctx)
+{
+	struct libusb_transfer *transfers[BULK_MAX_QUEUE_DEPTH];
+	struct timeval tv = { 0, 100000 };
+	int depth = ctx->acc->queue_depth;
+	int cancelled = 0;
+	int i;
+
+	for (i = 0; i < depth; i++) {
+		transfers[i] = pool_get(&transfer_pool);
+		if (transfers[i] == NULL) {
+			printf("failed to allocate bulk transfer\n");
+			depth = i;
+			ctx->error = LIBUSB_ERROR_NO_MEM;
+			goto end;
+		}
+		transfers[i]->callback = xfer_cb;
+	}
+
+	for (i = 0; i < depth && !ctx->error; i++) {
+		/* Out of usbfs memory: go on with the transfers queued */
+		if ((xfer_submit(ctx, transfers[i]) == LIBUSB_ERROR_NO_MEM)
+		    && (i > 0)) {
+			printf("usbfs memory limit reached, %d transfers in "
+			       "flight\n", i);
+			ctx->error = 0;
+			break;
+		}
+	}
+
+	while (ctx->inflight > 0) {
+		if ((ctx->error || stop_acc || (ctx->done == ctx->end))
+		    && !cancelled) {
+			for (i = 0; i < depth; i++)
+				libusb_cancel_transfer(transfers[i]);
+			cancelled = 1;
+		}
+		libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+	}
+
+end:
+	for (i = 0; i < depth; i++)
+		pool_put(&transfer_pool, transfers[i]);
+
+	if (!ctx->error && stop_acc)
+		ctx->error = LIBUSB_ERROR_INTERRUPTED;
+	if (ctx->error)
+		printf("Bulk transfer failed after %llu bytes: %s\n",
+		       (unsigned long long)ctx->done,
+		       libusb_error_name(ctx->error));
+
+	return ctx->error ? -1 : 0;
+}
+
+static const char *xfer_name(const char *path)
+{
+	const char *name = strrchr(path, '/');
+
+	return name ? name + 1 : path;
+}
+
+static void print_rate(const char *what, uint64_t bytes, double elapsed)
+{
+	if (elapsed <= 0)
+		elapsed = 1e-9;
+	printf("%s %llu bytes in %.3f s (%.1f MB/s)\n", what,
+	       (unsigned long long)bytes, elapsed, bytes / elapsed / 1e6);
+}
+
+int push_file(accessory_t *acc, const char *path)
+{
+	struct xfer_ctx ctx;
+	struct xfer_hdr hdr, ack;
+	struct stat st;
+	unsigned char *map = NULL;
+	uint64_t offset, map_off, map_len = 0;
+	const char *name = xfer_name(path);
+	double start;
+	int ret = -1;
+	int fd;
+
+	if (bulk_open(acc) < 0)
+		return -1;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		printf("Unable to open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st) < 0) {
+		printf("Unable to stat %s: %s\n", path, strerror(errno));
+		goto end;
+	}
+
+	offset = (acc->xfer_offset > 0) ? (uint64_t)acc->xfer_offset : 0;
+	if (offset > (uint64_t)st.st_size) {
+		printf("Offset %llu is beyond the end of %s\n",
+		       (unsigned long long)offset, path);
+		goto end;
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.acc = acc;
+	ctx.endpoint = AOA_ACCESSORY_EP_OUT;
+	ctx.end = st.st_size - offset;
+
+	/* mmap offsets must be page aligned */
+	map_off = offset & ~((uint64_t)sysconf(_SC_PAGESIZE) - 1);
+	map_len = st.st_size - map_off;
+	if (map_len) {
+		map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, map_off);
+		if (map == MAP_FAILED) {
+			printf("Unable to map %s: %s\n", path, strerror(errno));
+			map = NULL;
+			goto end;
+		}
+		madvise(map, map_len, MADV_SEQUENTIAL);
+		madvise(map, map_len, MADV_WILLNEED);
+		ctx.base = map + (offset - map_off);
+	}
+
+	crc32_init();
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.type = XFER_PUSH;
+	hdr.name_len = strnlen(name, XFER_NAME_MAX);
+	hdr.offset = offset;
+	hdr.length = ctx.end;
+	hdr.crc = crc32_update(0, ctx.base, ctx.end);
+
+	printf("Pushing %s (%llu bytes from offset %llu, "
+	       "%d KiB x %d transfers)\n", path,
+	       (unsigned long long)hdr.length, (unsigned long long)offset,
+	       acc->xfer_size / 1024, acc->queue_depth);
+
+	start = util_now();
+	if (send_hdr(acc, &hdr, name) < 0)
+		goto end;
+	if (xfer_run(&ctx) < 0)
+		goto end;
+	if (recv_hdr(acc, &ack) < 0)
+		goto end;
+
+	if ((ack.type != XFER_ACK) || (ack.offset != hdr.offset)
+	    || (ack.length != hdr.length) || (ack.crc != hdr.crc)) {
+		printf("Device did not acknowledge the transfer "
+		       "(got %llu bytes, crc %08x, expected crc %08x)\n",
+		       (unsigned long long)ack.length, ack.crc, hdr.crc);
+		goto end;
+	}
+
+	print_rate("Pushed", ctx.done, util_now() - start);
+	ret = 0;
+
+end:
+	if (map)
+		munmap(map, map_len);
+	close(fd);
+	return ret;
+}
+
+int pull_file(accessory_t *acc, const char *path)
+{
+	struct xfer_ctx ctx;
+	struct xfer_hdr hdr, data;
+	struct stat st;
+	unsigned char *map = NULL;
+	uint64_t offset, total, page, map_off, map_len = 0;
+	const char *name = xfer_name(path);
+	double start;
+	int ret = -1;
+	int err;
+	int fd;
+
+	if (bulk_open(acc) < 0)
+		return -1;
+
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		printf("Unable to open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st) < 0) {
+		printf("Unable to stat %s: %s\n", path, strerror(errno));
+		goto end;
+	}
+
+	/* A negative offset resumes after what is already on disk */
+	if (acc->xfer_offset < 0)
+		offset = st.st_size;
+	else
+		offset = acc->xfer_offset;
+	if (offset > (uint64_t)st.st_size) {
+		printf("Offset %llu is beyond the end of %s\n",
+		       (unsigned long long)offset, path);
+		goto end;
+	}
+
+	crc32_init();
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.type = XFER_PULL;
+	hdr.name_len = strnlen(name, XFER_NAME_MAX);
+	hdr.offset = offset;
+
+	start = util_now();
+	if (send_hdr(acc, &hdr, name) < 0)
+		goto end;
+	if (recv_hdr(acc, &data) < 0)
+		goto end;
+	if ((data.type != XFER_DATA) || (data.offset != offset)) {
+		printf("Unexpected answer to pull request\n");
+		goto end;
+	}
+	/* A phone not announcing its write size fills whole transfers */
+	if (!data.chunk)
+		data.chunk = acc->xfer_size;
+	if (data.chunk > BULK_MAX_XFER_SIZE) {
+		printf("Device write size %u is too large\n", data.chunk);
+		goto end;
+	}
+
+	printf("Pulling %s (%llu bytes from offset %llu, "
+	       "%u-byte writes x %d transfers)\n", path,
+	       (unsigned long long)data.length, (unsigned long long)offset,
+	       data.chunk, acc->queue_depth);
+
+	/* Preallocate the destination so the mapping never faults in blocks */
+	total = offset + data.length;
+	if (ftruncate(fd, offset) < 0) {
+		printf("Unable to resize %s: %s\n", path, strerror(errno));
+		goto end;
+	}
+	if (data.length) {
+		err = posix_fallocate(fd, offset, data.length);
+		if ((err == EOPNOTSUPP) || (err == EINVAL)) {
+			/* The filesystem cannot preallocate: only size it */
+			if (ftruncate(fd, total) < 0) {
+				printf("Unable to resize %s: %s\n", path,
+				       strerror(errno));
+				goto end;
+			}
+		} else if (err) {
+			printf("Unable to allocate %s: %s\n", path,
+			       strerror(err));
+			goto end;
+		}
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.acc = acc;
+	ctx.endpoint = AOA_ACCESSORY_EP_IN;
+	ctx.end = data.length;
+	ctx.chunk = data.chunk;
+
+	/*
+	 * Transfers queued after a short write land further than their
+	 * data belongs, up to one transfer past the end: map the file over
+	 * the start of an anonymous area with that much slack.
+	 */
+	page = sysconf(_SC_PAGESIZE);
+	map_off = offset & ~(page - 1);
+	if (data.length) {
+		map_len = ((total - map_off + page - 1) & ~(page - 1))
+		    + xfer_in_size(&ctx);
+		map = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if ((map == MAP_FAILED)
+		    || (mmap(map, total - map_off, PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_FIXED, fd, map_off)
+			== MAP_FAILED)) {
+			printf("Unable to map %s: %s\n", path, strerror(errno));
+			if (map != MAP_FAILED)
+				munmap(map, map_len);
+			map = NULL;
+			goto end;
+		}
+		madvise(map, total - map_off, MADV_SEQUENTIAL);
+		ctx.base = map + (offset - map_off);
+	}
+
+	if (xfer_run(&ctx) < 0)
+		goto truncate;
+
+	if (ctx.crc != data.crc) {
+		printf("CRC mismatch: got %08x, expected %08x\n", ctx.crc,
+		       data.crc);
+		ctx.done = 0;
+		goto truncate;
+	}
+
+	print_rate("Pulled", ctx.done, util_now() - start);
+	ret = 0;
+	goto end;
+
+truncate:
+	/* Keep only what was received in order so the pull can resume */
+	if (map) {
+		munmap(map, map_len);
+		map = NULL;
+	}
+	if (ftruncate(fd, offset + ctx.done) == 0)
+		printf("Kept %llu bytes, resume with --offset auto\n",
+		       (unsigned long long)(offset + ctx.done));
+
+end:
+	if (map)
+		munmap(map, map_len);
+	close(fd);
+	return ret;
+}
+
+#else /* _WIN32 */
+
+int push_file(accessory_t *acc, const char *path)
+{
+	printf("File transfer is not supported on this platform\n");
+	return -1;
+}
+
+int pull_file(accessory_t *acc, const char *path)
+{
+	printf("File transfer is not supported on this platform\n");
+	return -1;
+}
+
+#endif /* _WIN32 */
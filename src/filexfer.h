@@ -0,0 +1,67 @@
+/*
+ * Linux ADK - filexfer.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _FILEXFER_H_
+#define _FILEXFER_H_
+
+/*
+ * File transfer framing
+ *
+ * Every frame starts with a 32-byte little-endian header, always sent as
+ * its own bulk transfer, optionally followed by the file name (name_len
+ * bytes, same transfer) and then by the payload (length bytes, any number
+ * of transfers, see below for DATA):
+ *
+ *   0  magic     u32  XFER_MAGIC
+ *   4  type      u16  XFER_PUSH, XFER_PULL, XFER_DATA, XFER_ACK, XFER_ERR
+ *   6  name_len  u16
+ *   8  offset    u64  file offset of the first payload byte
+ *  16  length    u64  payload length (0 in a PULL means "up to EOF")
+ *  24  crc       u32  CRC-32 (IEEE) of the payload
+ *  28  chunk     u32  DATA: bytes per payload write, else 0
+ *
+ * push: host sends PUSH + name + payload, phone answers ACK (or ERR) with
+ *       the offset/length/crc it has stored.
+ * pull: host sends PULL + name with the resume offset, phone answers DATA
+ *       + payload (or ERR).
+ *
+ * The phone writes a DATA payload chunk bytes at a time, and f_accessory
+ * ends every write with a short packet or a ZLP. The host queues one IN
+ * transfer per write, a packet larger than chunk, so each write completes
+ * exactly one transfer. A write may come up short, but only the last one
+ * should: any other short write or lone ZLP costs a copy of the data
+ * queued behind it. A write longer than chunk is an error. A chunk of 0
+ * means the host transfer size, so writes should not be larger than that.
+ */
+#define XFER_MAGIC		0x464b4441	/* "ADKF" */
+#define XFER_HDR_SIZE		32
+#define XFER_NAME_MAX		255
+
+#define XFER_PUSH		1
+#define XFER_PULL		2
+#define XFER_DATA		3
+#define XFER_ACK		4
+#define XFER_ERR		5
+
+/* Functions */
+extern int push_file(accessory_t *acc, const char *path);
+extern int pull_file(accessory_t *acc, const char *path);
+
+#endif /* _FILEXFER_H_ */
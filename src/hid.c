@@ -27,6 +27,10 @@
 
 #include "linux-adk.h"
 #include "hid.h"
+#include "hist.h"
+#include "pacing.h"
+#include "pool.h"
+#include "util.h"
 
 /**
  * Mouse descriptor from the specification:
@@ -104,13 +108,121 @@ static const unsigned char mouse_report_desc[]  = {
     0xC0,
 };
 
-int send_hid_descriptor(accessory_t * acc)
+/**
+ * Gamepad descriptor: 16 buttons, a hat switch, two sticks and two
+ * analog triggers, following the layout of §E.7 (Joystick) and the
+ * Game Pad / Simulation Controls usages of the HID Usage Tables.
+ *
+ * Report layout (13 bytes, little endian):
+ *   0-1   buttons, bit n = button n + 1
+ *   2     hat switch in the low nibble (HID_HAT_CENTERED = null state)
+ *   3-10  X, Y, Z, Rz (left and right sticks), signed 16 bits
+ *   11    brake (left trigger)
+ *   12    accelerator (right trigger)
+ */
+static const unsigned char gamepad_report_desc[]  = {
+    // Usage Page (Generic Desktop)
+    0x05, 0x01,
+    // Usage (Game Pad)
+    0x09, 0x05,
+
+    // Collection (Application)
+    0xA1, 0x01,
+
+    // Usage Page (Buttons)
+    0x05, 0x09,
+    // Usage Minimum (1)
+    0x19, 0x01,
+    // Usage Maximum (16)
+    0x29, 0x10,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (1)
+    0x25, 0x01,
+    // Report Count (16)
+    0x95, 0x10,
+    // Report Size (1)
+    0x75, 0x01,
+    // Input (Data, Variable, Absolute): 16 buttons bits
+    0x81, 0x02,
+
+    // Usage Page (Generic Desktop)
+    0x05, 0x01,
+    // Usage (Hat switch)
+    0x09, 0x39,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (7)
+    0x25, 0x07,
+    // Physical Minimum (0)
+    0x35, 0x00,
+    // Physical Maximum (315)
+    0x46, 0x3B, 0x01,
+    // Unit (Degrees)
+    0x65, 0x14,
+    // Report Count (1)
+    0x95, 0x01,
+    // Report Size (4)
+    0x75, 0x04,
+    // Input (Data, Variable, Absolute, Null State): hat
+    0x81, 0x42,
+    // Unit (None)
+    0x65, 0x00,
+    // Physical Minimum (0)
+    0x35, 0x00,
+    // Physical Maximum (0): physical range follows the logical one again
+    0x45, 0x00,
+    // Input (Constant): 4 bits padding
+    0x81, 0x01,
+
+    // Usage (X)
+    0x09, 0x30,
+    // Usage (Y)
+    0x09, 0x31,
+    // Usage (Z)
+    0x09, 0x32,
+    // Usage (Rz)
+    0x09, 0x35,
+    // Logical Minimum (-32767)
+    0x16, 0x01, 0x80,
+    // Logical Maximum (32767)
+    0x26, 0xFF, 0x7F,
+    // Report Size (16)
+    0x75, 0x10,
+    // Report Count (4)
+    0x95, 0x04,
+    // Input (Data, Variable, Absolute): 2 sticks
+    0x81, 0x02,
+
+    // Usage Page (Simulation Controls)
+    0x05, 0x02,
+    // Usage (Brake)
+    0x09, 0xC5,
+    // Usage (Accelerator)
+    0x09, 0xC4,
+    // Logical Minimum (0)
+    0x15, 0x00,
+    // Logical Maximum (255)
+    0x26, 0xFF, 0x00,
+    // Report Size (8)
+    0x75, 0x08,
+    // Report Count (2)
+    0x95, 0x02,
+    // Input (Data, Variable, Absolute): 2 triggers
+    0x81, 0x02,
+
+    // End Collection
+    0xC0,
+};
+
+static int register_hid(accessory_t *acc, uint16_t id,
+			const unsigned char *desc, uint16_t len)
 {
 	int ret;
 
 	ret = libusb_control_transfer(acc->handle, LIBUSB_ENDPOINT_OUT |
 				      LIBUSB_REQUEST_TYPE_VENDOR,
-				      AOA_REGISTER_HID, 1, ARRAY_LEN(mouse_report_desc),
+				      AOA_REGISTER_HID, id, len,
 				      NULL, 0, 0);
 	if (ret < 0) {
 		printf("couldn't register HID device on the android device : %s\n",
@@ -120,8 +232,8 @@ int send_hid_descriptor(accessory_t * acc)
 
 	ret = libusb_control_transfer(acc->handle, LIBUSB_ENDPOINT_OUT |
 				      LIBUSB_REQUEST_TYPE_VENDOR,
-				      AOA_SET_HID_REPORT_DESC, 1, 0,
-				      (unsigned char *) mouse_report_desc, ARRAY_LEN(mouse_report_desc), 0);
+				      AOA_SET_HID_REPORT_DESC, id, 0,
+				      (unsigned char *) desc, len, 0);
 	if (ret < 0) {
 		printf("couldn't send HID descriptor to the android device\n");
 		return -1;
@@ -131,32 +243,319 @@ int send_hid_descriptor(accessory_t * acc)
 	return 0;
 }
 
+static void LIBUSB_CALL hid_event_cb(struct libusb_transfer *t)
+{
+	*(int *)t->user_data = 1;
+}
+
+/*
+ * SEND_HID_EVENT from a pooled transfer and setup buffer, so the report
+ * path does not allocate. Completion times are fed back to the pacer, if
+ * any.
+ */
+static int send_hid_event(accessory_t *acc, uint16_t id,
+			  unsigned char *report, uint16_t len)
+{
+	struct libusb_transfer *t;
+	unsigned char *buf;
+	double start;
+	int done = 0;
+	int ret;
+
+	if (len > POOL_REPORT_SIZE - LIBUSB_CONTROL_SETUP_SIZE)
+		return LIBUSB_ERROR_INVALID_PARAM;
+
+	t = pool_get(&transfer_pool);
+	buf = pool_get(&report_pool);
+	if ((t == NULL) || (buf == NULL)) {
+		ret = LIBUSB_ERROR_NO_MEM;
+		goto end;
+	}
+
+	libusb_fill_control_setup(buf, LIBUSB_ENDPOINT_OUT |
+				  LIBUSB_REQUEST_TYPE_VENDOR,
+				  AOA_SEND_HID_EVENT, id, 0, len);
+	memcpy(buf + LIBUSB_CONTROL_SETUP_SIZE, report, len);
+	libusb_fill_control_transfer(t, acc->handle, buf, hid_event_cb, &done,
+				     0);
+
+	start = util_now();
+	if (acc->pacer)
+		hid_pacer_submit(acc->pacer, start);
+	ret = libusb_submit_transfer(t);
+	if (ret < 0)
+		goto end;
+	while (!done)
+		libusb_handle_events_completed(NULL, &done);
+
+	if (t->status != LIBUSB_TRANSFER_COMPLETED) {
+		ret = (t->status == LIBUSB_TRANSFER_NO_DEVICE) ?
+		    LIBUSB_ERROR_NO_DEVICE : LIBUSB_ERROR_IO;
+		goto end;
+	}
+
+	ret = t->actual_length;
+	if (acc->pacer)
+		hid_pacer_sample(acc->pacer, util_now() - start);
+
+end:
+	pool_put(&report_pool, buf);
+	pool_put(&transfer_pool, t);
+	return ret;
+}
+
+int send_hid_descriptor(accessory_t * acc)
+{
+	return register_hid(acc, HID_MOUSE_ID, mouse_report_desc,
+			    ARRAY_LEN(mouse_report_desc));
+}
+
+static int clamp(int v, int min, int max)
+{
+	return v < min ? min : (v > max ? max : v);
+}
+
+/* Pointer position along a 400x400 square, at 1 pixel per millisecond */
+static void mouse_demo_pos(int ms, int *x, int *y)
+{
+	int side = (ms / 400) % 4;
+	int d = ms % 400;
+
+	switch (side) {
+	case 0:
+		*x = d;
+		*y = 0;
+		break;
+	case 1:
+		*x = 400;
+		*y = d;
+		break;
+	case 2:
+		*x = 400 - d;
+		*y = 400;
+		break;
+	default:
+		*x = 0;
+		*y = 400 - d;
+		break;
+	}
+}
+
+/*
+ * Demo input source: the pointer follows a square for HID_DEMO_MS. The
+ * motion accumulated since the previous report is sent at each slot
+ * handed out by the pacer.
+ */
 int send_hid_inputs(accessory_t *acc)
 {
-    unsigned char *buffer = calloc(1, 4);
-    if (buffer) {
-        buffer[0] = 0;
-        buffer[1] = 10;
-        buffer[2] = 10;
-        buffer[3] = 0;
-
-        int ret;
-        for (uint8_t i = 0; i < 16; i++) {
-            ret = libusb_control_transfer(acc->handle, LIBUSB_ENDPOINT_OUT |
-                              LIBUSB_REQUEST_TYPE_VENDOR,
-                              AOA_SEND_HID_EVENT, 1, 0,
-                              buffer, 4, 0);
-            if (ret < 0) {
-                printf("couldn't send HID event %d\n", i);
-                break;
-            }
-            sleep(1);
-        }
-    } else {
-        printf("failed to allocate HID event buffer\n");
-        return -1;
-    }
-
-    free(buffer);
-    return 0;
+	hid_pacer_t pacer;
+	unsigned char *buffer;
+	int x, y, cur_x = 0, cur_y = 0;
+	double start;
+	int ret = 0;
+
+	buffer = pool_get(&report_pool);
+	if (buffer == NULL) {
+		printf("failed to allocate HID event buffer\n");
+		return -1;
+	}
+	memset(buffer, 0, 4);
+
+	hid_pacer_init(&pacer, acc->hid_rate);
+	acc->pacer = &pacer;
+
+	start = util_now();
+	while (!stop_acc) {
+		int ms = (util_now() - start) * 1000;
+
+		if (ms >= HID_DEMO_MS)
+			break;
+
+		mouse_demo_pos(ms, &x, &y);
+		buffer[1] = clamp(x - cur_x, -127, 127);
+		buffer[2] = clamp(y - cur_y, -127, 127);
+		if (buffer[1] || buffer[2]) {
+			ret = send_hid_event(acc, HID_MOUSE_ID, buffer, 4);
+			if (ret < 0) {
+				printf("couldn't send HID event at %d ms\n", ms);
+				break;
+			}
+			cur_x += (signed char)buffer[1];
+			cur_y += (signed char)buffer[2];
+		}
+
+		hid_pacer_wait(&pacer);
+	}
+
+	acc->pacer = NULL;
+	hid_pacer_print(&pacer);
+
+	pool_put(&report_pool, buffer);
+	return ret < 0 ? -1 : 0;
+}
+
+int send_gamepad_descriptor(accessory_t *acc)
+{
+	return register_hid(acc, HID_GAMEPAD_ID, gamepad_report_desc,
+			    ARRAY_LEN(gamepad_report_desc));
+}
+
+void hid_gamepad_init(hid_gamepad_t *gp, int deadzone)
+{
+	memset(gp, 0, sizeof(*gp));
+	gp->deadzone = deadzone;
+}
+
+static void put_s16(unsigned char *p, int16_t v)
+{
+	p[0] = (uint16_t)v;
+	p[1] = (uint16_t)v >> 8;
+}
+
+static int get_s16(const unsigned char *p)
+{
+	return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static void gamepad_encode(const hid_gamepad_state_t *state,
+			   hid_gamepad_report_t *report)
+{
+	unsigned char *p = report->bytes;
+
+	memset(report, 0, sizeof(*report));
+	p[0] = state->buttons;
+	p[1] = state->buttons >> 8;
+	p[2] = (state->hat < HID_HAT_CENTERED) ? state->hat : HID_HAT_CENTERED;
+	/* -32768 is outside the logical range */
+	put_s16(p + 3, state->lx < -32767 ? -32767 : state->lx);
+	put_s16(p + 5, state->ly < -32767 ? -32767 : state->ly);
+	put_s16(p + 7, state->rx < -32767 ? -32767 : state->rx);
+	put_s16(p + 9, state->ry < -32767 ? -32767 : state->ry);
+	p[11] = state->lt;
+	p[12] = state->rt;
+}
+
+/* Does the new report differ from the last one by more than the deadzone? */
+static int gamepad_changed(const hid_gamepad_t *gp,
+			   const hid_gamepad_report_t *report)
+{
+	const unsigned char *a = report->bytes;
+	const unsigned char *b = gp->last.bytes;
+	int i;
+
+	/* Buttons and hat are exact */
+	if ((a[0] != b[0]) || (a[1] != b[1]) || (a[2] != b[2]))
+		return 1;
+
+	for (i = 3; i < 11; i += 2)
+		if (abs(get_s16(a + i) - get_s16(b + i)) > gp->deadzone)
+			return 1;
+
+	/* Triggers only have 8 bits of resolution */
+	for (i = 11; i < HID_GAMEPAD_REPORT_SIZE; i++)
+		if (abs(a[i] - b[i]) > (gp->deadzone >> 8))
+			return 1;
+
+	return 0;
+}
+
+int hid_gamepad_update(accessory_t *acc, hid_gamepad_t *gp,
+		       const hid_gamepad_state_t *state)
+{
+	hid_gamepad_report_t report;
+	unsigned int i;
+	int ret;
+
+	gamepad_encode(state, &report);
+
+	if (gp->have_last) {
+		/* Cheap word-wise check first, most snapshots are identical */
+		for (i = 0; i < ARRAY_LEN(report.words); i++)
+			if (report.words[i] != gp->last.words[i])
+				break;
+		if (i == ARRAY_LEN(report.words)) {
+			gp->suppressed_same++;
+			return 0;
+		}
+		if (!gamepad_changed(gp, &report)) {
+			gp->suppressed_deadzone++;
+			return 0;
+		}
+	}
+
+	ret = send_hid_event(acc, HID_GAMEPAD_ID, report.bytes,
+			     HID_GAMEPAD_REPORT_SIZE);
+	if (ret < 0) {
+		gp->failed++;
+		return ret;
+	}
+
+	gp->last = report;
+	gp->have_last = 1;
+	gp->sent++;
+	return 1;
+}
+
+void hid_gamepad_print_stats(const hid_gamepad_t *gp)
+{
+	printf("Gamepad reports: %lu sent, %lu suppressed (%lu identical, "
+	       "%lu within deadzone), %lu failed\n", gp->sent,
+	       gp->suppressed_same + gp->suppressed_deadzone,
+	       gp->suppressed_same, gp->suppressed_deadzone, gp->failed);
+}
+
+/*
+ * Demo input source: HID_GAMEPAD_DEMO_MS of 1 kHz snapshots of a pad
+ * polled at 125 Hz, with the left stick tracing a square and button 1
+ * toggling every second.
+ */
+int send_gamepad_inputs(accessory_t *acc)
+{
+	hid_gamepad_state_t state;
+	hid_gamepad_t gp;
+	hid_pacer_t pacer;
+	uint64_t start;
+	int ret = 0;
+	int ms;
+
+	hid_gamepad_init(&gp, acc->deadzone);
+	hid_pacer_init(&pacer, acc->hid_rate);
+	acc->pacer = &pacer;
+	memset(&state, 0, sizeof(state));
+	state.hat = HID_HAT_CENTERED;
+
+	start = util_now_ns();
+	for (ms = 0; ms < HID_GAMEPAD_DEMO_MS && !stop_acc; ms++) {
+		int phase = ms % 1000;
+		int pos = -32767 + (phase / 8) * 520;
+
+		state.buttons = (ms / 1000) & 1;
+		switch ((ms / 1000) % 4) {
+		case 0:
+			state.lx = pos;
+			break;
+		case 1:
+			state.ly = pos;
+			break;
+		case 2:
+			state.lx = -pos;
+			break;
+		default:
+			state.ly = -pos;
+			break;
+		}
+
+		/* Between pacer slots only the latest snapshot is kept */
+		if (hid_pacer_ready(&pacer)
+		    && ((ret = hid_gamepad_update(acc, &gp, &state)) < 0)) {
+			printf("couldn't send gamepad event at %d ms\n", ms);
+			break;
+		}
+		util_sleep_until_ns(start + (ms + 1) * 1000000ULL);
+	}
+
+	acc->pacer = NULL;
+	hid_gamepad_print_stats(&gp);
+	hid_pacer_print(&pacer);
+	return ret < 0 ? -1 : 0;
 }
@@ -21,8 +21,50 @@
 #ifndef _HID_H_
 #define _HID_H_
 
+/* HID device IDs */
+#define HID_MOUSE_ID			1
+#define HID_GAMEPAD_ID			2
+
+/* Length of the demo input sequences */
+#define HID_DEMO_MS			8000
+#define HID_GAMEPAD_DEMO_MS		5000
+
+#define HID_GAMEPAD_REPORT_SIZE		13
+#define HID_HAT_CENTERED		8	/* 0-7: N, NE, E, ... NW */
+
+/* Full controller state, as sampled by the input source */
+typedef struct _hid_gamepad_state_t {
+	uint16_t buttons;	/* bit n = button n + 1 */
+	uint8_t hat;
+	int16_t lx, ly;		/* left stick */
+	int16_t rx, ry;		/* right stick */
+	uint8_t lt, rt;		/* triggers */
+} hid_gamepad_state_t;
+
+typedef union _hid_gamepad_report_t {
+	uint32_t words[4];
+	unsigned char bytes[16];
+} hid_gamepad_report_t;
+
+/* Gamepad device: reports are only sent when the state really changes */
+typedef struct _hid_gamepad_t {
+	int deadzone;		/* stick units, triggers use deadzone / 256 */
+	int have_last;
+	hid_gamepad_report_t last;	/* last report sent */
+	unsigned long sent;
+	unsigned long suppressed_same;
+	unsigned long suppressed_deadzone;
+	unsigned long failed;
+} hid_gamepad_t;
+
 /* Functions */
 extern int send_hid_descriptor(accessory_t *acc);
 extern int send_hid_inputs(accessory_t *acc);
+extern int send_gamepad_descriptor(accessory_t *acc);
+extern int send_gamepad_inputs(accessory_t *acc);
+extern void hid_gamepad_init(hid_gamepad_t *gp, int deadzone);
+extern int hid_gamepad_update(accessory_t *acc, hid_gamepad_t *gp,
+			      const hid_gamepad_state_t *state);
+extern void hid_gamepad_print_stats(const hid_gamepad_t *gp);
 
 #endif /* _HID_H_ */
@@ -0,0 +1,87 @@
+/*
+ * Linux ADK - hist.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdint.h>
+
+#include "linux-adk.h"
+#include "hist.h"
+
+static unsigned int hist_bucket(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned int msb = 0;
+
+	if (us < 16)
+		return us;
+	while ((us >> msb) > 1)
+		msb++;
+	if (msb > 31)
+		return HIST_BUCKETS - 1;
+	return (msb - 3) * 16 + ((us >> (msb - 4)) & 15);
+}
+
+/* Middle of a bucket, in ms */
+static double hist_value(unsigned int bucket)
+{
+	unsigned int msb = bucket / 16 + 3;
+	double lo, width;
+
+	if (bucket < 16)
+		return (bucket + 0.5) / 1000;
+	width = (double)(1u << (msb - 4));
+	lo = (16 + bucket % 16) * width;
+	return (lo + width / 2) / 1000;
+}
+
+void hist_record(hist_t *h, uint64_t ns)
+{
+	if (!h->count || (ns < h->min))
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+	h->sum += ns;
+	h->bucket[hist_bucket(ns)]++;
+	h->count++;
+}
+
+/* Percentile in ms, 0 when empty */
+double hist_percentile(const hist_t *h, int pct)
+{
+	unsigned long rank, n = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+
+	rank = (h->count * pct + 99) / 100;
+	for (i = 0; i < HIST_BUCKETS - 1; i++) {
+		n += h->bucket[i];
+		if (n >= rank)
+			break;
+	}
+
+	return hist_value(i);
+}
+
+/* Mean in ms, 0 when empty */
+double hist_avg(const hist_t *h)
+{
+	return h->count ? h->sum / 1e6 / h->count : 0;
+}
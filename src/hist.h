@@ -0,0 +1,44 @@
+/*
+ * Linux ADK - hist.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _HIST_H_
+#define _HIST_H_
+
+/*
+ * Latency histogram with a fixed footprint: log-linear buckets, 16 per
+ * power of two of microseconds (about 6% resolution). Min, max and mean
+ * are exact.
+ */
+#define HIST_BUCKETS		512
+
+typedef struct _hist_t {
+	unsigned long count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;		/* ns */
+	unsigned long bucket[HIST_BUCKETS];
+} hist_t;
+
+/* Functions */
+extern void hist_record(hist_t *h, uint64_t ns);
+extern double hist_percentile(const hist_t *h, int pct);
+extern double hist_avg(const hist_t *h);
+
+#endif /* _HIST_H_ */
@@ -26,6 +26,10 @@
 #include <libusb.h>
 
 #include "linux-adk.h"
+#include "bulk.h"
+#include "ping.h"
+#include "pool.h"
+#include "rt.h"
 
 extern void accessory_main(accessory_t * acc);
 
@@ -55,10 +59,21 @@ static void show_help(char *name)
 	    ("Linux Accessory Development Kit\n\nusage: %s [OPTIONS]\nOPTIONS:\n"
 	     "\t-a, --aoa-max-version\n\t\tAOA maximum version to be used. "
 	     "Default is no maximum version.\n"
+	     "\t-A, --alloc-check\n\t\tabort if a pool has to fall back to "
+	     "the heap after the handshake, and print pool usage.\n"
+	     "\t-b, --pool-buffers\n\t\tnumber of preallocated bulk buffers. "
+	     "Default is %d.\n"
+	     "\t-c, --cpu\n\t\tpin the USB thread to this CPU.\n"
 	     "\t-d, --device\n\t\tUSB device product and vendor IDs. "
 	     "Default is \"%s\".\n"
 	     "\t-D, --description\n\t\taccessory description. "
 	     "Default is \"%s\".\n"
+	     "\t-e, --echo\n\t\trun as the echo peer for --ping on this "
+	     "gadget device (e.g. " PING_ECHO_DEVICE ") and exit.\n"
+	     "\t-g, --gamepad\n\t\tregister a gamepad instead of a mouse.\n"
+	     "\t-i, --ping\n\t\tmeasure round-trip latency with this many "
+	     "probes on the bulk endpoints.\n"
+	     "\t-l, --ping-size\n\t\tprobe size in bytes. Default is %d.\n"
 	     "\t-m, --manufacturer\n\t\tmanufacturer's name. "
 	     "Default is \"%s\".\n"
 	     "\t-M, --model\n\t\tmodel's name. "
@@ -67,16 +82,34 @@ static void show_help(char *name)
 	     "Default is \"%s\".\n"
 	     "\t-N, --no_app\n\t\toption that allows to connect without an "
 	     "Android App (AOA v2.0 only, for Audio and HID).\n"
+	     "\t-o, --offset\n\t\tresume a push or pull at this byte offset, "
+	     "\"auto\" resumes a pull after the existing file data.\n"
+	     "\t-p, --push\n\t\tsend this file to the accessory app.\n"
+	     "\t-P, --pull\n\t\treceive this file from the accessory app.\n"
+	     "\t-q, --queue-depth\n\t\tnumber of bulk transfers in flight. "
+	     "Default follows the link speed.\n"
+	     "\t-r, --hid-rate\n\t\tfixed HID report rate in reports per "
+	     "second. Default is adaptive.\n"
+	     "\t-R, --ping-rate\n\t\tprobes per second. Default is %d.\n"
 	     "\t-s, --serial\n\t\tserial numder. "
 	     "Default is \"%s\".\n"
+	     "\t-S, --simulate\n\t\tuse a simulated echo device instead "
+	     "of a phone (--ping and --mux-bench only).\n"
+	     "\t-t, --rt-priority\n\t\trun the USB thread under SCHED_FIFO "
+	     "at this priority, with memory locked.\n"
 	     "\t-u, --url\n\t\taccessory url. "
 	     "Default is \"%s\".\n"
+	     "\t-x, --mux-bench\n\t\tbenchmark this many virtual channels "
+	     "(at most 8) on the bulk endpoints.\n"
+	     "\t-z, --deadzone\n\t\tgamepad stick changes up to this value "
+	     "are not reported. Default is 0.\n"
 	     "\t-v, --version\n\t\tShow program version and exit.\n"
 	     "\t-V, --verbose\n\t\tSets libusb verbose mode.\n"
 	     "\t-h, --help\n\t\tShow this help and exit.\n", name,
-	     acc_default.device, acc_default.description,
+	     POOL_DEFAULT_BULK_COUNT, acc_default.device,
+	     acc_default.description, PING_DEFAULT_SIZE,
 	     acc_default.manufacturer, acc_default.model, acc_default.version,
-	     acc_default.serial, acc_default.url);
+	     PING_DEFAULT_RATE, acc_default.serial, acc_default.url);
 	return;
 }
 
@@ -98,9 +131,9 @@ int main(int argc, char *argv[])
 	int arg_count = 1;
 	int no_app = 0;
 	int aoa_max_version = -1;
-	accessory_t acc = { NULL, NULL, 0, 0, 0, NULL, NULL, NULL, NULL, NULL,
-		NULL, NULL
-	};
+	char *echo_dev = NULL;
+	int alloc_check = 0;
+	accessory_t acc = { .rt_cpu = -1 };
 
 	if (signal(SIGINT, signal_handler) == SIG_ERR)
 		printf("Cannot setup a signal handler...\n");
@@ -113,6 +146,15 @@ int main(int argc, char *argv[])
 		if ((strcmp(argv[arg_count], "-a") == 0)
 		    || (strcmp(argv[arg_count], "--aoa-max-version") == 0)) {
 			aoa_max_version= atoi(argv[++arg_count]);
+		} else if ((strcmp(argv[arg_count], "-A") == 0)
+			   || (strcmp(argv[arg_count], "--alloc-check") == 0)) {
+			alloc_check = 1;
+		} else if ((strcmp(argv[arg_count], "-b") == 0)
+			   || (strcmp(argv[arg_count], "--pool-buffers") == 0)) {
+			acc.pool_buffers = atoi(argv[++arg_count]);
+		} else if ((strcmp(argv[arg_count], "-c") == 0)
+			   || (strcmp(argv[arg_count], "--cpu") == 0)) {
+			acc.rt_cpu = atoi(argv[++arg_count]);
 		} else if ((strcmp(argv[arg_count], "-d") == 0)
 			   || (strcmp(argv[arg_count], "--device") == 0)) {
 			acc.device = argv[++arg_count];
@@ -120,6 +162,18 @@ int main(int argc, char *argv[])
 			   || (strcmp(argv[arg_count], "--description")
 			       == 0)) {
 			acc.description = argv[++arg_count];
+		} else if ((strcmp(argv[arg_count], "-e") == 0)
+			   || (strcmp(argv[arg_count], "--echo") == 0)) {
+			echo_dev = argv[++arg_count];
+		} else if ((strcmp(argv[arg_count], "-g") == 0)
+			   || (strcmp(argv[arg_count], "--gamepad") == 0)) {
+			acc.gamepad = 1;
+		} else if ((strcmp(argv[arg_count], "-i") == 0)
+			   || (strcmp(argv[arg_count], "--ping") == 0)) {
+			acc.ping_count = strtoul(argv[++arg_count], NULL, 0);
+		} else if ((strcmp(argv[arg_count], "-l") == 0)
+			   || (strcmp(argv[arg_count], "--ping-size") == 0)) {
+			acc.ping_size = atoi(argv[++arg_count]);
 		} else if ((strcmp(argv[arg_count], "-m") == 0)
 			   || (strcmp(argv[arg_count], "--manufacturer")
 			       == 0)) {
@@ -134,12 +188,47 @@ int main(int argc, char *argv[])
 		} else if ((strcmp(argv[arg_count], "-N") == 0)
 			   || (strcmp(argv[arg_count], "--no_app") == 0)) {
 			no_app = 1;
+		} else if ((strcmp(argv[arg_count], "-o") == 0)
+			   || (strcmp(argv[arg_count], "--offset") == 0)) {
+			arg_count++;
+			if (strcmp(argv[arg_count], "auto") == 0)
+				acc.xfer_offset = -1;
+			else
+				acc.xfer_offset = strtoll(argv[arg_count],
+							  NULL, 0);
+		} else if ((strcmp(argv[arg_count], "-p") == 0)
+			   || (strcmp(argv[arg_count], "--push") == 0)) {
+			acc.push_file = argv[++arg_count];
+		} else if ((strcmp(argv[arg_count], "-P") == 0)
+			   || (strcmp(argv[arg_count], "--pull") == 0)) {
+			acc.pull_file = argv[++arg_count];
+		} else if ((strcmp(argv[arg_count], "-q") == 0)
+			   || (strcmp(argv[arg_count], "--queue-depth") == 0)) {
+			acc.queue_depth = atoi(argv[++arg_count]);
+		} else if ((strcmp(argv[arg_count], "-r") == 0)
+			   || (strcmp(argv[arg_count], "--hid-rate") == 0)) {
+			acc.hid_rate = atof(argv[++arg_count]);
+		} else if ((strcmp(argv[arg_count], "-R") == 0)
+			   || (strcmp(argv[arg_count], "--ping-rate") == 0)) {
+			acc.ping_rate = atof(argv[++arg_count]);
 		} else if ((strcmp(argv[arg_count], "-s") == 0)
 			   || (strcmp(argv[arg_count], "--serial") == 0)) {
 			acc.serial = argv[++arg_count];
+		} else if ((strcmp(argv[arg_count], "-S") == 0)
+			   || (strcmp(argv[arg_count], "--simulate") == 0)) {
+			acc.simulate = 1;
+		} else if ((strcmp(argv[arg_count], "-t") == 0)
+			   || (strcmp(argv[arg_count], "--rt-priority") == 0)) {
+			acc.rt_priority = atoi(argv[++arg_count]);
 		} else if ((strcmp(argv[arg_count], "-u") == 0)
 			   || (strcmp(argv[arg_count], "--url") == 0)) {
 			acc.url = argv[++arg_count];
+		} else if ((strcmp(argv[arg_count], "-x") == 0)
+			   || (strcmp(argv[arg_count], "--mux-bench") == 0)) {
+			acc.mux_channels = atoi(argv[++arg_count]);
+		} else if ((strcmp(argv[arg_count], "-z") == 0)
+			   || (strcmp(argv[arg_count], "--deadzone") == 0)) {
+			acc.deadzone = atoi(argv[++arg_count]);
 		} else if ((strcmp(argv[arg_count], "-v") == 0)
 			   || (strcmp(argv[arg_count], "--version") == 0)) {
 			show_version(argv[0]);
@@ -170,13 +259,35 @@ int main(int argc, char *argv[])
 	if (!acc.url)
 		acc.url = acc_default.url;
 
+	/* Device side of the latency probe, no host USB involved */
+	if (echo_dev)
+		return ping_echo(echo_dev) ? 1 : 0;
+
+	/* Everything used after the handshake is allocated here */
+	if (pools_init(&acc) < 0)
+		return 1;
+	pool_set_check(alloc_check);
+
+	if (acc.simulate) {
+		acc.pid = AOA_ACCESSORY_PID;
+		if (rt_enter(&acc) == 0)
+			accessory_main(&acc);
+		goto stats;
+	}
+
 	if (init_accessory(&acc, aoa_max_version) != 0)
 		goto end;
 
+	if (rt_enter(&acc) < 0)
+		goto end;
 	accessory_main(&acc);
 
 end:
 	fini_accessory(&acc);
+stats:
+	if (alloc_check)
+		pools_print_stats();
+	pools_fini();
 	return 0;
 }
 
@@ -334,7 +445,7 @@ static void fini_accessory(accessory_t * acc)
 	printf("Closing USB device\n");
 
 	if (acc->handle != NULL) {
-		libusb_release_interface(acc->handle, 0);
+		bulk_close(acc);
 		libusb_close(acc->handle);
 	}
 
@@ -494,7 +605,10 @@ void print_descriptor(libusb_device_handle *handle)
                     printf("        bRefresh:         %u\n", ep.bRefresh);
                     printf("        bSynchAddress:    %u\n", ep.bSynchAddress);
 
-                    for (int m = 0; m < ep.extra_length;) {
+                    /* Walk the extra descriptors by their bLength */
+                    for (int m = 0; m + 1 < ep.extra_length; m += ep.extra[m]) {
+                        if (ep.extra[m] == 0)
+                            break;
                         if (LIBUSB_DT_SS_ENDPOINT_COMPANION == ep.extra[m + 1]) {
                             struct libusb_ss_endpoint_companion_descriptor *ep_comp;
 
@@ -510,7 +624,6 @@ void print_descriptor(libusb_device_handle *handle)
                             
                             libusb_free_ss_endpoint_companion_descriptor(ep_comp);
                         }
-                        m += ep.extra[i];
                     }
                 }
             }
@@ -79,6 +79,32 @@ typedef struct _accessory_t {
 	char *version;
 	char *url;
 	char *serial;
+	/* HID */
+	int gamepad;
+	int deadzone;
+	double hid_rate;	/* reports/s, <= 0: adaptive */
+	struct _hid_pacer_t *pacer;
+	/* Bulk transfers */
+	int bulk_claimed;
+	int xfer_size;
+	int queue_depth;
+	int pool_buffers;
+	int max_packet;		/* wMaxPacketSize of the OUT endpoint */
+	int64_t xfer_offset;	/* < 0: resume after existing data */
+	char *push_file;
+	char *pull_file;
+	/* Latency probe */
+	uint32_t ping_count;
+	int ping_size;
+	double ping_rate;
+	/* Virtual channels */
+	int mux_channels;
+	/* Real-time mode */
+	int rt_priority;	/* SCHED_FIFO priority, 0: off */
+	int rt_cpu;		/* < 0: not pinned */
+	/* Simulated device */
+	int simulate;
+	struct _sim_dev_t *sim;
 } accessory_t;
 
 #endif /* _LINUX_ADK_H_ */
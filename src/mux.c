@@ -0,0 +1,737 @@
+/*
+ * Linux ADK - mux.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <libusb.h>
+
+#include "linux-adk.h"
+#include "bulk.h"
+#include "hist.h"
+#include "mux.h"
+#include "pool.h"
+#include "rt.h"
+#include "simdev.h"
+#include "util.h"
+
+#define MUX_DEFAULT_PACKET	512
+#define MUX_CREDIT_THRESHOLD	(MUX_WINDOW / 4)
+
+/* Benchmark parameters */
+#define MUX_BENCH_MS		5000
+#define MUX_BENCH_RPC_SIZE	64
+#define MUX_BENCH_MSG_SIZE	4096
+
+static void put_hdr(unsigned char *p, int ch, int type, int len)
+{
+	p[0] = ch;
+	p[1] = type;
+	put_le16(p + 2, len);
+}
+
+/* Called locked: room for len bytes in the filling buffer, or NULL */
+static unsigned char *mux_reserve(mux_t *mux, int len)
+{
+	unsigned char *p;
+
+	while (mux->running && !mux->error
+	       && (mux->tx_len + len > mux->tx_limit)) {
+		pthread_cond_signal(&mux->tx_cond);
+		pthread_cond_wait(&mux->cond, &mux->lock);
+	}
+	if (!mux->running || mux->error)
+		return NULL;
+
+	p = mux->tx_buf[mux->tx_cur] + mux->tx_len;
+	mux->tx_len += len;
+	return p;
+}
+
+/* Called locked */
+static int mux_queue_credit(mux_t *mux, int ch, uint32_t bytes)
+{
+	unsigned char *p = mux_reserve(mux, MUX_HDR_SIZE + 4);
+
+	if (p == NULL)
+		return -1;
+
+	put_hdr(p, ch, MUX_CREDIT, 4);
+	put_le32(p + MUX_HDR_SIZE, bytes);
+	mux->frames_out++;
+	pthread_cond_signal(&mux->tx_cond);
+	return 0;
+}
+
+/*
+ * Frames queued while a transfer is in flight pile up in the other
+ * buffer, so they leave together in the next transfer.
+ */
+static void *mux_tx_thread(void *arg)
+{
+	mux_t *mux = arg;
+	unsigned char *buf;
+	int len, ret;
+
+	pthread_mutex_lock(&mux->lock);
+	for (;;) {
+		while (mux->running && !mux->tx_len)
+			pthread_cond_wait(&mux->tx_cond, &mux->lock);
+		if (!mux->tx_len)
+			break;
+
+		buf = mux->tx_buf[mux->tx_cur];
+		len = mux->tx_len;
+		mux->tx_cur ^= 1;
+		mux->tx_len = 0;
+		pthread_cond_broadcast(&mux->cond);
+		pthread_mutex_unlock(&mux->lock);
+
+		ret = bulk_write(mux->acc, buf, len, BULK_TIMEOUT);
+
+		pthread_mutex_lock(&mux->lock);
+		if (ret != len) {
+			printf("Multiplexer send failed: %s\n", ret < 0 ?
+			       libusb_error_name(ret) : "short write");
+			mux->error = ret < 0 ? ret : LIBUSB_ERROR_IO;
+			pthread_cond_broadcast(&mux->cond);
+			break;
+		}
+		mux->transfers_out++;
+	}
+	pthread_mutex_unlock(&mux->lock);
+
+	return NULL;
+}
+
+static void ring_put(mux_chan_t *c, const unsigned char *src, uint32_t len)
+{
+	uint32_t tail = (c->rx_head + c->rx_len) % MUX_WINDOW;
+	uint32_t first = MUX_WINDOW - tail;
+
+	if (first > len)
+		first = len;
+	memcpy(c->rx + tail, src, first);
+	memcpy(c->rx, src + first, len - first);
+	c->rx_len += len;
+}
+
+static void ring_get(mux_chan_t *c, unsigned char *dst, uint32_t len)
+{
+	uint32_t first = MUX_WINDOW - c->rx_head;
+
+	if (first > len)
+		first = len;
+	memcpy(dst, c->rx + c->rx_head, first);
+	memcpy(dst + first, c->rx, len - first);
+	c->rx_head = (c->rx_head + len) % MUX_WINDOW;
+	c->rx_len -= len;
+}
+
+/* Called locked: returns the bytes used, a partial frame is left over */
+static int mux_parse(mux_t *mux, const unsigned char *p, int len)
+{
+	int used = 0;
+
+	while (len - used >= MUX_HDR_SIZE) {
+		int ch = p[used];
+		int type = p[used + 1];
+		int n = get_le16(p + used + 2);
+		const unsigned char *payload = p + used + MUX_HDR_SIZE;
+		mux_chan_t *c = NULL;
+
+		if (n > len - used - MUX_HDR_SIZE)
+			break;
+
+		if (ch < MUX_MAX_CHANNELS)
+			c = &mux->chan[ch];
+		if (c == NULL) {
+			mux->protocol_errors++;
+		} else if (!c->open) {
+			/* Late frames for a channel we closed */
+		} else if (type == MUX_DATA) {
+			/* The peer may not send more than we credited */
+			if ((uint32_t)n > MUX_WINDOW - c->rx_len) {
+				mux->protocol_errors++;
+			} else {
+				ring_put(c, payload, n);
+				c->rx_bytes += n;
+			}
+		} else if ((type == MUX_CREDIT) && (n == 4)) {
+			c->tx_credit += get_le32(payload);
+		} else {
+			mux->protocol_errors++;
+		}
+
+		mux->frames_in++;
+		used += MUX_HDR_SIZE + n;
+	}
+
+	return used;
+}
+
+static void *mux_rx_thread(void *arg)
+{
+	mux_t *mux = arg;
+	int packet = mux->acc->max_packet > 0 ? mux->acc->max_packet :
+		     MUX_DEFAULT_PACKET;
+	int ret, len, used, room;
+
+	while (mux->running) {
+		/* Whole packets only, or the device could overflow the read */
+		room = (bulk_pool.size - mux->rx_have) / packet * packet;
+		if (!room) {
+			/* A frame that can never fit: nothing to resync on */
+			pthread_mutex_lock(&mux->lock);
+			mux->protocol_errors++;
+			pthread_mutex_unlock(&mux->lock);
+			mux->rx_have = 0;
+			continue;
+		}
+
+		ret = bulk_read(mux->acc, mux->rx_buf + mux->rx_have, room,
+				100);
+		if (ret == LIBUSB_ERROR_TIMEOUT)
+			continue;
+
+		pthread_mutex_lock(&mux->lock);
+		if (ret < 0) {
+			printf("Multiplexer receive failed: %s\n",
+			       libusb_error_name(ret));
+			mux->error = ret;
+			pthread_cond_broadcast(&mux->cond);
+			pthread_mutex_unlock(&mux->lock);
+			break;
+		}
+		len = mux->rx_have + ret;
+		used = mux_parse(mux, mux->rx_buf, len);
+		mux->rx_have = len - used;
+		if (mux->rx_have && used) {
+			memmove(mux->rx_buf, mux->rx_buf + used, mux->rx_have);
+		}
+		mux->transfers_in++;
+		pthread_cond_broadcast(&mux->cond);
+		pthread_mutex_unlock(&mux->lock);
+	}
+
+	return NULL;
+}
+
+int mux_open(mux_t *mux, accessory_t *acc)
+{
+	int packet;
+
+	memset(mux, 0, sizeof(*mux));
+	mux->acc = acc;
+
+	if (bulk_open(acc) < 0)
+		return -1;
+
+	/* Pack up to a whole number of max size packets */
+	packet = acc->max_packet > 0 ? acc->max_packet : MUX_DEFAULT_PACKET;
+	mux->tx_limit = (bulk_pool.size / packet) * packet;
+	if (mux->tx_limit < MUX_HDR_SIZE + 4)
+		mux->tx_limit = bulk_pool.size;
+
+	mux->tx_buf[0] = pool_get(&bulk_pool);
+	mux->tx_buf[1] = pool_get(&bulk_pool);
+	mux->rx_buf = pool_get(&bulk_pool);
+	if (!mux->tx_buf[0] || !mux->tx_buf[1] || !mux->rx_buf) {
+		printf("failed to allocate multiplexer buffers\n");
+		goto error;
+	}
+
+	pthread_mutex_init(&mux->lock, NULL);
+	pthread_cond_init(&mux->cond, NULL);
+	pthread_cond_init(&mux->tx_cond, NULL);
+	mux->running = 1;
+
+	if (rt_thread_create(&mux->tx_thread, mux_tx_thread, mux) != 0)
+		goto error_threads;
+	if (rt_thread_create(&mux->rx_thread, mux_rx_thread, mux) != 0) {
+		mux->running = 0;
+		pthread_cond_signal(&mux->tx_cond);
+		pthread_join(mux->tx_thread, NULL);
+		goto error_threads;
+	}
+
+	printf("Multiplexer: frames packed into transfers of up to %d bytes "
+	       "(wMaxPacketSize %d)\n", mux->tx_limit, packet);
+	return 0;
+
+error_threads:
+	printf("failed to start multiplexer threads\n");
+	mux->running = 0;
+	pthread_cond_destroy(&mux->tx_cond);
+	pthread_cond_destroy(&mux->cond);
+	pthread_mutex_destroy(&mux->lock);
+error:
+	pool_put(&bulk_pool, mux->tx_buf[0]);
+	pool_put(&bulk_pool, mux->tx_buf[1]);
+	pool_put(&bulk_pool, mux->rx_buf);
+	return -1;
+}
+
+/* Flushes queued frames, then stops both threads */
+void mux_close(mux_t *mux)
+{
+	int ch;
+
+	pthread_mutex_lock(&mux->lock);
+	mux->running = 0;
+	pthread_cond_broadcast(&mux->cond);
+	pthread_cond_signal(&mux->tx_cond);
+	pthread_mutex_unlock(&mux->lock);
+
+	pthread_join(mux->tx_thread, NULL);
+	pthread_join(mux->rx_thread, NULL);
+
+	for (ch = 0; ch < MUX_MAX_CHANNELS; ch++)
+		mux_channel_close(mux, ch);
+
+	pthread_cond_destroy(&mux->tx_cond);
+	pthread_cond_destroy(&mux->cond);
+	pthread_mutex_destroy(&mux->lock);
+	pool_put(&bulk_pool, mux->tx_buf[0]);
+	pool_put(&bulk_pool, mux->tx_buf[1]);
+	pool_put(&bulk_pool, mux->rx_buf);
+}
+
+int mux_channel_open(mux_t *mux, int ch)
+{
+	mux_chan_t *c;
+	int ret = 0;
+
+	if ((ch < 0) || (ch >= MUX_MAX_CHANNELS)
+	    || (bulk_pool.size < MUX_WINDOW))
+		return LIBUSB_ERROR_INVALID_PARAM;
+
+	c = &mux->chan[ch];
+	pthread_mutex_lock(&mux->lock);
+	if (c->open) {
+		ret = LIBUSB_ERROR_BUSY;
+		goto end;
+	}
+
+	memset(c, 0, sizeof(*c));
+	c->rx = pool_get(&bulk_pool);
+	if (c->rx == NULL) {
+		ret = LIBUSB_ERROR_NO_MEM;
+		goto end;
+	}
+	c->tx_credit = MUX_WINDOW;
+	c->open = 1;
+
+end:
+	pthread_mutex_unlock(&mux->lock);
+	return ret;
+}
+
+void mux_channel_close(mux_t *mux, int ch)
+{
+	mux_chan_t *c;
+
+	if ((ch < 0) || (ch >= MUX_MAX_CHANNELS))
+		return;
+
+	c = &mux->chan[ch];
+	pthread_mutex_lock(&mux->lock);
+	if (c->open) {
+		c->open = 0;
+		pool_put(&bulk_pool, c->rx);
+		c->rx = NULL;
+		pthread_cond_broadcast(&mux->cond);
+	}
+	pthread_mutex_unlock(&mux->lock);
+}
+
+/* Blocks until all of buf is queued; returns len or a libusb error */
+int mux_send(mux_t *mux, int ch, const void *buf, int len)
+{
+	const unsigned char *src = buf;
+	mux_chan_t *c;
+	int sent = 0;
+	int ret;
+
+	if ((ch < 0) || (ch >= MUX_MAX_CHANNELS))
+		return LIBUSB_ERROR_INVALID_PARAM;
+
+	c = &mux->chan[ch];
+	pthread_mutex_lock(&mux->lock);
+	while (sent < len) {
+		unsigned char *p;
+		int room, n;
+
+		if (!c->open || !mux->running || mux->error)
+			break;
+
+		room = mux->tx_limit - mux->tx_len - MUX_HDR_SIZE;
+		if (!c->tx_credit || (room <= 0)) {
+			if (room <= 0)
+				pthread_cond_signal(&mux->tx_cond);
+			pthread_cond_wait(&mux->cond, &mux->lock);
+			continue;
+		}
+
+		n = len - sent;
+		if ((uint32_t)n > c->tx_credit)
+			n = c->tx_credit;
+		if (n > room)
+			n = room;
+		if (n > MUX_MAX_PAYLOAD)
+			n = MUX_MAX_PAYLOAD;
+
+		p = mux->tx_buf[mux->tx_cur] + mux->tx_len;
+		put_hdr(p, ch, MUX_DATA, n);
+		memcpy(p + MUX_HDR_SIZE, src + sent, n);
+		mux->tx_len += MUX_HDR_SIZE + n;
+		mux->frames_out++;
+		c->tx_credit -= n;
+		c->tx_bytes += n;
+		sent += n;
+		pthread_cond_signal(&mux->tx_cond);
+	}
+
+	if (sent == len)
+		ret = len;
+	else if (mux->error)
+		ret = mux->error;
+	else
+		ret = LIBUSB_ERROR_NOT_FOUND;
+	pthread_mutex_unlock(&mux->lock);
+
+	return ret;
+}
+
+/*
+ * Reads whatever is available, up to len bytes. Returns the number of
+ * bytes read, 0 on timeout (0 waits forever) or a libusb error.
+ */
+int mux_recv(mux_t *mux, int ch, void *buf, int len, unsigned int timeout)
+{
+	struct timespec deadline;
+	mux_chan_t *c;
+	int ret = 0;
+	int n;
+
+	if ((ch < 0) || (ch >= MUX_MAX_CHANNELS))
+		return LIBUSB_ERROR_INVALID_PARAM;
+
+	c = &mux->chan[ch];
+	util_deadline(&deadline, timeout);
+
+	pthread_mutex_lock(&mux->lock);
+	while (c->open && !c->rx_len && mux->running && !mux->error
+	       && (ret != ETIMEDOUT)) {
+		if (timeout)
+			ret = pthread_cond_timedwait(&mux->cond, &mux->lock,
+						     &deadline);
+		else
+			pthread_cond_wait(&mux->cond, &mux->lock);
+	}
+
+	if (!c->open || !c->rx_len) {
+		if (mux->error)
+			n = mux->error;
+		else if (!c->open || !mux->running)
+			n = LIBUSB_ERROR_NOT_FOUND;
+		else
+			n = 0;
+		goto end;
+	}
+
+	n = len < (int)c->rx_len ? len : (int)c->rx_len;
+	ring_get(c, buf, n);
+
+	/* Hand the space back in batches rather than frame by frame */
+	c->rx_consumed += n;
+	if ((c->rx_consumed >= MUX_CREDIT_THRESHOLD)
+	    && (mux_queue_credit(mux, ch, c->rx_consumed) == 0))
+		c->rx_consumed = 0;
+
+end:
+	pthread_mutex_unlock(&mux->lock);
+	return n;
+}
+
+/*
+ * Reference peer, for the simulated device: DATA comes back unchanged on
+ * the same channel. Credit is only handed back to the host when the host
+ * returns credit to the peer, by the same amount; the peer then always
+ * has the credit it needs to echo what it is sent.
+ */
+struct mux_peer {
+	uint32_t credit[MUX_MAX_CHANNELS];	/* peer -> host */
+	int started[MUX_MAX_CHANNELS];
+	unsigned long errors;
+};
+
+void mux_echo_peer(sim_dev_t *sim, const unsigned char *buf, int len)
+{
+	struct mux_peer *peer = sim->peer_data;
+	unsigned char out[POOL_BULK_SIZE];
+	int out_len = 0;
+
+	while (len >= MUX_HDR_SIZE) {
+		int ch = buf[0];
+		int type = buf[1];
+		int n = get_le16(buf + 2);
+
+		if ((n > len - MUX_HDR_SIZE) || (ch >= MUX_MAX_CHANNELS)
+		    || (out_len + MUX_HDR_SIZE + n > (int)sizeof(out))) {
+			peer->errors++;
+			break;
+		}
+		if (!peer->started[ch]) {
+			peer->credit[ch] = MUX_WINDOW;
+			peer->started[ch] = 1;
+		}
+
+		if ((type == MUX_DATA) && ((uint32_t)n <= peer->credit[ch])) {
+			peer->credit[ch] -= n;
+			memcpy(out + out_len, buf, MUX_HDR_SIZE + n);
+			out_len += MUX_HDR_SIZE + n;
+		} else if ((type == MUX_CREDIT) && (n == 4)) {
+			peer->credit[ch] += get_le32(buf + MUX_HDR_SIZE);
+			memcpy(out + out_len, buf, MUX_HDR_SIZE + n);
+			out_len += MUX_HDR_SIZE + n;
+		} else {
+			peer->errors++;
+		}
+
+		buf += MUX_HDR_SIZE + n;
+		len -= MUX_HDR_SIZE + n;
+	}
+
+	if (out_len)
+		sim_reply(sim, out, out_len);
+}
+
+/* Benchmark: one RPC channel plus streaming channels competing with it */
+struct bench_chan {
+	mux_t *mux;
+	int ch;
+	int size;
+	volatile int *stop;
+	hist_t lat;
+	unsigned long long bytes;
+	int error;
+};
+
+static int recv_exact(struct bench_chan *b, unsigned char *buf, int len,
+		      volatile int *stop)
+{
+	int got = 0;
+	int ret;
+
+	while (got < len) {
+		ret = mux_recv(b->mux, b->ch, buf + got, len - got, 100);
+		if (ret < 0)
+			return ret;
+		if (!ret && *stop)
+			return 0;
+		got += ret;
+	}
+
+	return got;
+}
+
+static void stamp(unsigned char *buf)
+{
+	put_le64(buf, util_now_ns());
+}
+
+static uint64_t stamp_age(const unsigned char *buf)
+{
+	return util_now_ns() - get_le64(buf);
+}
+
+static void *bench_rpc(void *arg)
+{
+	struct bench_chan *b = arg;
+	unsigned char req[MUX_BENCH_RPC_SIZE] = { 0 };
+	unsigned char rsp[MUX_BENCH_RPC_SIZE];
+	int ret;
+
+	while (!*b->stop && !stop_acc) {
+		stamp(req);
+		ret = mux_send(b->mux, b->ch, req, sizeof(req));
+		if (ret < 0)
+			break;
+		ret = recv_exact(b, rsp, sizeof(rsp), b->stop);
+		if (ret <= 0)
+			break;
+		hist_record(&b->lat, stamp_age(rsp));
+		b->bytes += ret;
+	}
+
+	return NULL;
+}
+
+static void *bench_stream_tx(void *arg)
+{
+	struct bench_chan *b = arg;
+	unsigned char msg[MUX_BENCH_MSG_SIZE] = { 0 };
+
+	while (!*b->stop && !stop_acc) {
+		stamp(msg);
+		if (mux_send(b->mux, b->ch, msg, b->size) < 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static void *bench_stream_rx(void *arg)
+{
+	struct bench_chan *b = arg;
+	unsigned char msg[MUX_BENCH_MSG_SIZE];
+	static volatile int never;
+	int ret;
+
+	/* Keeps draining until the channel is closed */
+	while ((ret = recv_exact(b, msg, b->size, &never)) > 0) {
+		hist_record(&b->lat, stamp_age(msg));
+		b->bytes += ret;
+	}
+
+	return NULL;
+}
+
+int mux_bench(accessory_t *acc)
+{
+	static struct bench_chan chans[MUX_MAX_CHANNELS];
+	static struct mux_peer peer;
+	static mux_t mux;
+	pthread_t tx[MUX_MAX_CHANNELS], rx[MUX_MAX_CHANNELS];
+	volatile int stop = 0;
+	unsigned long long total = 0;
+	int nch = acc->mux_channels;
+	uint64_t start;
+	double secs;
+	int ret = -1;
+	int ch;
+
+	if (nch > MUX_MAX_CHANNELS)
+		nch = MUX_MAX_CHANNELS;
+
+	if (acc->simulate) {
+		memset(&peer, 0, sizeof(peer));
+		if (sim_open(acc, mux_echo_peer, &peer) < 0)
+			return -1;
+	}
+	if (mux_open(&mux, acc) < 0)
+		goto end;
+
+	memset(chans, 0, sizeof(chans));
+	for (ch = 0; ch < nch; ch++) {
+		chans[ch].mux = &mux;
+		chans[ch].ch = ch;
+		chans[ch].stop = &stop;
+		chans[ch].size = ch ? MUX_BENCH_MSG_SIZE : MUX_BENCH_RPC_SIZE;
+		if (mux_channel_open(&mux, ch) < 0) {
+			printf("failed to open channel %d\n", ch);
+			nch = ch;
+			break;
+		}
+	}
+
+	printf("Benchmarking %d channels for %d ms: channel 0 does %d-byte "
+	       "round trips, the others stream %d-byte messages\n", nch,
+	       MUX_BENCH_MS, MUX_BENCH_RPC_SIZE, MUX_BENCH_MSG_SIZE);
+
+	/* Receiver before sender, a receiver alone just idles until closed */
+	start = util_now_ns();
+	for (ch = 0; ch < nch; ch++) {
+		if (ch && (rt_thread_create(&rx[ch], bench_stream_rx,
+					    &chans[ch]) != 0))
+			break;
+		if (rt_thread_create(&tx[ch], ch ? bench_stream_tx : bench_rpc,
+				     &chans[ch]) != 0) {
+			if (ch) {
+				mux_channel_close(&mux, ch);
+				pthread_join(rx[ch], NULL);
+			}
+			break;
+		}
+	}
+	if (ch < nch) {
+		printf("failed to start benchmark threads for channel %d\n",
+		       ch);
+		nch = ch;
+	}
+	pool_seal();
+
+	while (!stop_acc && (util_now_ns() - start < MUX_BENCH_MS * 1000000ULL))
+		usleep(10000);
+	stop = 1;
+
+	/*
+	 * Closing the channels wakes senders blocked on credit, which never
+	 * comes back if the peer dropped a transfer.
+	 */
+	secs = (util_now_ns() - start) / 1e9;
+	for (ch = 0; ch < nch; ch++) {
+		mux_channel_close(&mux, ch);
+		pthread_join(tx[ch], NULL);
+		if (ch)
+			pthread_join(rx[ch], NULL);
+	}
+
+	if (!nch)
+		goto close;
+
+	printf("  ch  role        msgs      MB/s    avg ms    p99 ms"
+	       "    max ms\n");
+	for (ch = 0; ch < nch; ch++) {
+		struct bench_chan *b = &chans[ch];
+
+		printf("  %2d  %-6s %9lu %9.2f %9.3f %9.3f %9.3f\n", ch,
+		       ch ? "stream" : "rpc", b->lat.count,
+		       b->bytes / secs / 1e6, hist_avg(&b->lat),
+		       hist_percentile(&b->lat, 99),
+		       b->lat.max / 1e6);
+		total += b->bytes;
+	}
+	if (acc->simulate && acc->sim->dropped)
+		printf("Simulated device dropped %lu transfers\n",
+		       acc->sim->dropped);
+	printf("Aggregate: %.2f MB/s, %lu transfers out carrying %lu frames "
+	       "(%.1f per transfer), %lu in, %lu protocol errors\n",
+	       total / secs / 1e6, mux.transfers_out, mux.frames_out,
+	       mux.transfers_out ?
+	       (double)mux.frames_out / mux.transfers_out : 0,
+	       mux.transfers_in, mux.protocol_errors);
+
+	ret = 0;
+
+close:
+	mux_close(&mux);
+end:
+	if (acc->simulate)
+		sim_close(acc);
+	return ret;
+}
@@ -0,0 +1,102 @@
+/*
+ * Linux ADK - mux.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _MUX_H_
+#define _MUX_H_
+
+#include <pthread.h>
+
+/*
+ * Virtual channels over the accessory bulk endpoints
+ *
+ * Each bulk transfer carries one or more whole frames, packed back to
+ * back up to the largest multiple of wMaxPacketSize that fits a bulk
+ * pool buffer. Both sides end every transfer with a short or zero-length
+ * packet, so the receiver never waits for more data. A transfer the host
+ * only gets part of before a read times out is still parsed frame by
+ * frame, across reads. Frame header, little endian:
+ *
+ *   0  chan  u8
+ *   1  type  u8   MUX_DATA or MUX_CREDIT
+ *   2  len   u16  payload length
+ *
+ * Channels are byte streams with credit-based flow control: each side
+ * starts with MUX_WINDOW bytes of credit per channel, and may not send
+ * more DATA than it has credit for. The receiver hands credit back with
+ * a CREDIT frame (u32 payload: number of bytes) once the application
+ * has consumed the data, so a slow channel never blocks the others.
+ */
+#define MUX_MAX_CHANNELS	8
+#define MUX_HDR_SIZE		4
+#define MUX_WINDOW		16384	/* one bulk pool buffer */
+#define MUX_MAX_PAYLOAD		65535
+
+#define MUX_DATA		1
+#define MUX_CREDIT		2
+
+struct _sim_dev_t;
+
+typedef struct _mux_chan_t {
+	int open;
+	uint32_t tx_credit;	/* bytes we may still send */
+	unsigned char *rx;	/* ring of MUX_WINDOW bytes */
+	uint32_t rx_head;
+	uint32_t rx_len;
+	uint32_t rx_consumed;	/* not credited back yet */
+	unsigned long tx_bytes;
+	unsigned long rx_bytes;
+} mux_chan_t;
+
+typedef struct _mux_t {
+	accessory_t *acc;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;	/* data, credit or buffer space */
+	pthread_cond_t tx_cond;	/* frames waiting to go out */
+	pthread_t tx_thread;
+	pthread_t rx_thread;
+	unsigned char *tx_buf[2];	/* one filling, one in flight */
+	int tx_cur;
+	int tx_len;
+	int tx_limit;
+	unsigned char *rx_buf;
+	int rx_have;		/* start of a frame carried to the next read */
+	volatile int running;
+	int error;
+	mux_chan_t chan[MUX_MAX_CHANNELS];
+	unsigned long transfers_out;
+	unsigned long frames_out;
+	unsigned long transfers_in;
+	unsigned long frames_in;
+	unsigned long protocol_errors;
+} mux_t;
+
+/* Functions */
+extern int mux_open(mux_t *mux, accessory_t *acc);
+extern void mux_close(mux_t *mux);
+extern int mux_channel_open(mux_t *mux, int ch);
+extern void mux_channel_close(mux_t *mux, int ch);
+extern int mux_send(mux_t *mux, int ch, const void *buf, int len);
+extern int mux_recv(mux_t *mux, int ch, void *buf, int len,
+		    unsigned int timeout);
+extern void mux_echo_peer(struct _sim_dev_t *sim, const unsigned char *buf,
+			  int len);
+extern int mux_bench(accessory_t *acc);
+
+#endif /* _MUX_H_ */
@@ -0,0 +1,165 @@
+/*
+ * Linux ADK - pacing.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "linux-adk.h"
+#include "hist.h"
+#include "pacing.h"
+#include "util.h"
+
+/* Base latency is re-measured every PACER_PERIOD samples */
+#define PACER_PERIOD		256
+/* Queueing delay tolerated before cutting the rate */
+#define PACER_QUEUE_FRAC	0.5
+#define PACER_QUEUE_MIN		0.0005	/* s */
+#define PACER_CUT		0.8
+#define PACER_PROBE		0.02
+#define PACER_COOLDOWN		16
+/* Weight of past cuts kept at each period */
+#define PACER_CUT_DECAY		0.5
+
+/* A rate <= 0 selects adaptive pacing, anything else a fixed rate */
+void hid_pacer_init(hid_pacer_t *p, double rate)
+{
+	memset(p, 0, sizeof(*p));
+
+	if (rate > 0) {
+		p->rate = p->min_rate = p->max_rate = rate;
+	} else {
+		p->adaptive = 1;
+		p->min_rate = PACER_MIN_RATE;
+		p->max_rate = PACER_MAX_RATE;
+		p->rate = PACER_MIN_RATE * 10;
+	}
+	p->period_min = 1e9;
+	p->next = util_now();
+}
+
+/* Is the next report slot due? Does not block. */
+int hid_pacer_ready(hid_pacer_t *p)
+{
+	double t = util_now();
+
+	if (t < p->next)
+		return 0;
+
+	p->slot = p->next;
+	/* Slots missed while idle are not made up for */
+	if (t - p->next > 1.0 / p->rate)
+		p->next = t;
+	p->next += 1.0 / p->rate;
+	return 1;
+}
+
+/* Sleep until the next report slot */
+void hid_pacer_wait(hid_pacer_t *p)
+{
+	util_sleep_until_ns(p->next * 1e9);
+	hid_pacer_ready(p);
+}
+
+/* A report of the current slot is being submitted at time t */
+void hid_pacer_submit(hid_pacer_t *p, double t)
+{
+	if (p->slot && (t >= p->slot))
+		hist_record(&p->jitter, (t - p->slot) * 1e9);
+}
+
+void hid_pacer_sample(hid_pacer_t *p, double latency)
+{
+	double queue;
+
+	p->samples++;
+	if (!p->srtt) {
+		p->srtt = p->base_lat = latency;
+	} else {
+		p->srtt += (latency - p->srtt) / 8;
+	}
+
+	/* Track the windowed minimum so the base follows a replugged phone */
+	if (latency < p->period_min)
+		p->period_min = latency;
+	if (latency < p->base_lat)
+		p->base_lat = latency;
+	if (p->samples % PACER_PERIOD == 0) {
+		p->base_lat = p->period_min;
+		p->period_min = 1e9;
+		/* Old slowdowns stop holding the probe back */
+		p->recent_cuts *= PACER_CUT_DECAY;
+	}
+
+	if (!p->adaptive)
+		return;
+
+	if (p->cooldown)
+		p->cooldown--;
+
+	queue = p->srtt - p->base_lat;
+	if (queue > p->base_lat * PACER_QUEUE_FRAC + PACER_QUEUE_MIN) {
+		if (!p->cooldown) {
+			p->rate *= PACER_CUT;
+			p->cooldown = PACER_COOLDOWN;
+			p->recent_cuts++;
+			p->cuts++;
+		}
+	} else {
+		p->rate += p->rate * PACER_PROBE / (1 + p->recent_cuts);
+	}
+
+	/* Do not probe far beyond what the phone has shown it can take */
+	if (p->rate > hid_pacer_capacity(p) * 1.25)
+		p->rate = hid_pacer_capacity(p) * 1.25;
+	if (p->rate > p->max_rate)
+		p->rate = p->max_rate;
+	if (p->rate < p->min_rate)
+		p->rate = p->min_rate;
+}
+
+double hid_pacer_rate(const hid_pacer_t *p)
+{
+	return p->rate;
+}
+
+/* Estimated link capacity in reports per second */
+double hid_pacer_capacity(const hid_pacer_t *p)
+{
+	if (p->base_lat <= 0)
+		return p->max_rate;
+	return 1.0 / p->base_lat;
+}
+
+void hid_pacer_print(const hid_pacer_t *p)
+{
+	printf("HID pacing: %s rate %.0f reports/s, coalescing window %.2f ms, "
+	       "estimated capacity %.0f reports/s (completion %.3f ms, "
+	       "smoothed %.3f ms, %lu samples, %lu rate cuts)\n",
+	       p->adaptive ? "adaptive" : "fixed", p->rate, 1000.0 / p->rate,
+	       hid_pacer_capacity(p), p->base_lat * 1000, p->srtt * 1000,
+	       p->samples, p->cuts);
+
+	if (p->jitter.count)
+		printf("HID submit jitter: avg %.3f ms, p99 %.3f ms, "
+		       "max %.3f ms over %lu reports\n", hist_avg(&p->jitter),
+		       hist_percentile(&p->jitter, 99), p->jitter.max / 1e6,
+		       p->jitter.count);
+}
@@ -0,0 +1,68 @@
+/*
+ * Linux ADK - pacing.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _PACING_H_
+#define _PACING_H_
+
+/* Report rate limits, in reports per second */
+#define PACER_MIN_RATE		10.0
+#define PACER_MAX_RATE		2000.0
+
+/*
+ * Closed-loop HID report pacer.
+ *
+ * Every SEND_HID_EVENT completion time is fed back with hid_pacer_sample().
+ * The smallest recent completion time is taken as the unloaded service
+ * time of the phone; when the smoothed completion time grows above it,
+ * reports are queueing up somewhere and the rate is cut, otherwise it is
+ * probed upwards. Input produced between two reports is coalesced by the
+ * caller into the next one, so the coalescing window is 1 / rate.
+ *
+ * hid_pacer_submit() records how late each report went out compared to
+ * its slot, which is what the real-time mode is meant to bring down.
+ */
+typedef struct _hid_pacer_t {
+	double rate;		/* reports per second */
+	double min_rate;
+	double max_rate;
+	double base_lat;	/* unloaded completion time (s) */
+	double period_min;	/* smallest completion time this period */
+	double srtt;		/* smoothed completion time (s) */
+	double next;		/* time of the next report slot */
+	double slot;		/* time the current slot was due */
+	hist_t jitter;		/* submit time - slot time */
+	int adaptive;
+	int cooldown;		/* samples before the rate may be cut again */
+	double recent_cuts;	/* decays, slows probing after cuts */
+	unsigned long samples;
+	unsigned long cuts;	/* lifetime, for the stats only */
+} hid_pacer_t;
+
+/* Functions */
+extern void hid_pacer_init(hid_pacer_t *p, double rate);
+extern int hid_pacer_ready(hid_pacer_t *p);
+extern void hid_pacer_wait(hid_pacer_t *p);
+extern void hid_pacer_submit(hid_pacer_t *p, double t);
+extern void hid_pacer_sample(hid_pacer_t *p, double latency);
+extern double hid_pacer_rate(const hid_pacer_t *p);
+extern double hid_pacer_capacity(const hid_pacer_t *p);
+extern void hid_pacer_print(const hid_pacer_t *p);
+
+#endif /* _PACING_H_ */
@@ -0,0 +1,248 @@
+/*
+ * Linux ADK - ping.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libusb.h>
+
+#include "linux-adk.h"
+#include "bulk.h"
+#include "hist.h"
+#include "ping.h"
+#include "pool.h"
+#include "rt.h"
+#include "simdev.h"
+#include "util.h"
+
+/*
+ * Statistics live in fixed-size tables so a run of any length does not
+ * allocate: duplicates are tracked over a window of sequence numbers and
+ * RTTs go into a histogram from which the p99 is read.
+ */
+#define PING_WINDOW		4096
+
+struct ping_ctx {
+	accessory_t *acc;
+	uint32_t count;
+	int size;
+	uint32_t window[PING_WINDOW];	/* seq + 1 of probes seen */
+	hist_t rtt;
+	hist_t jitter;			/* submit time - scheduled time */
+	uint32_t max_seq;
+	unsigned long sent;
+	unsigned long reordered;
+	unsigned long duplicates;
+	unsigned long corrupted;
+	volatile int done;
+};
+
+static void *ping_receiver(void *arg)
+{
+	struct ping_ctx *ctx = arg;
+	unsigned char buf[PING_MAX_SIZE];
+	uint64_t tx_ns, rx_ns;
+	uint32_t seq;
+	int ret;
+
+	while (!ctx->done) {
+		ret = bulk_read(ctx->acc, buf, ctx->size, 100);
+		rx_ns = util_now_ns();
+		if (ret == LIBUSB_ERROR_TIMEOUT)
+			continue;
+		if (ret < 0) {
+			printf("Error receiving echo: %s\n",
+			       libusb_error_name(ret));
+			break;
+		}
+
+		if ((ret < PING_HDR_SIZE) || (get_le32(buf) != PING_MAGIC)
+		    || (get_le32(buf + 16) != (uint32_t)ret)) {
+			ctx->corrupted++;
+			continue;
+		}
+
+		seq = get_le32(buf + 4);
+		tx_ns = get_le64(buf + 8);
+		if ((seq >= ctx->count) || (tx_ns > rx_ns)) {
+			ctx->corrupted++;
+			continue;
+		}
+		if (ctx->window[seq % PING_WINDOW] == seq + 1) {
+			ctx->duplicates++;
+			continue;
+		}
+
+		if (ctx->rtt.count && (seq < ctx->max_seq))
+			ctx->reordered++;
+		else
+			ctx->max_seq = seq;
+
+		ctx->window[seq % PING_WINDOW] = seq + 1;
+		hist_record(&ctx->rtt, rx_ns - tx_ns);
+	}
+
+	return NULL;
+}
+
+static void ping_print_stats(struct ping_ctx *ctx)
+{
+	unsigned long received = ctx->rtt.count;
+
+	printf("--- accessory ping statistics ---\n");
+	printf("%lu probes sent, %lu received, %.1f%% loss, %lu reordered, "
+	       "%lu duplicates, %lu corrupted\n", ctx->sent, received,
+	       ctx->sent ? 100.0 * (ctx->sent - received) / ctx->sent : 0,
+	       ctx->reordered, ctx->duplicates, ctx->corrupted);
+
+	if (ctx->jitter.count)
+		printf("submit jitter avg/p99/max = %.3f/%.3f/%.3f ms\n",
+		       hist_avg(&ctx->jitter), hist_percentile(&ctx->jitter, 99),
+		       ctx->jitter.max / 1e6);
+
+	if (!received)
+		return;
+
+	printf("rtt min/avg/p99/max = %.3f/%.3f/%.3f/%.3f ms\n",
+	       ctx->rtt.min / 1e6, hist_avg(&ctx->rtt),
+	       hist_percentile(&ctx->rtt, 99), ctx->rtt.max / 1e6);
+}
+
+int ping_accessory(accessory_t *acc)
+{
+	static struct ping_ctx ctx;
+	unsigned char buf[PING_MAX_SIZE];
+	pthread_t receiver;
+	uint64_t start, interval, deadline;
+	uint32_t seq;
+	int ret = -1;
+
+	if (acc->simulate && sim_open(acc, sim_echo_peer, NULL) < 0)
+		return -1;
+	if (bulk_open(acc) < 0)
+		return -1;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.acc = acc;
+	ctx.count = acc->ping_count;
+	ctx.size = acc->ping_size ? acc->ping_size : PING_DEFAULT_SIZE;
+	if (ctx.size < PING_HDR_SIZE)
+		ctx.size = PING_HDR_SIZE;
+	if (ctx.size > PING_MAX_SIZE)
+		ctx.size = PING_MAX_SIZE;
+	interval = 1e9 / (acc->ping_rate > 0 ? acc->ping_rate :
+			  PING_DEFAULT_RATE);
+
+	if (rt_thread_create(&receiver, ping_receiver, &ctx) != 0) {
+		printf("failed to start ping receiver\n");
+		goto end;
+	}
+	pool_seal();
+
+	printf("PING accessory: %u probes of %d bytes, %.0f probes/s\n",
+	       ctx.count, ctx.size, 1e9 / interval);
+
+	memset(buf, 0, ctx.size);
+	put_le32(buf, PING_MAGIC);
+	put_le32(buf + 16, ctx.size);
+
+	start = util_now_ns();
+	for (seq = 0; (seq < ctx.count) && !stop_acc; seq++) {
+		uint64_t due = start + seq * interval;
+		uint64_t tx_ns;
+
+		util_sleep_until_ns(due);
+
+		tx_ns = util_now_ns();
+		hist_record(&ctx.jitter, tx_ns > due ? tx_ns - due : 0);
+		put_le32(buf + 4, seq);
+		put_le64(buf + 8, tx_ns);
+
+		ret = bulk_write(acc, buf, ctx.size, BULK_TIMEOUT);
+		if (ret < 0) {
+			printf("Error sending probe %u: %s\n", seq,
+			       libusb_error_name(ret));
+			break;
+		}
+		ctx.sent++;
+	}
+
+	/* Give late echoes a chance before counting them as lost */
+	deadline = util_now_ns() + PING_DRAIN_MS * 1000000ULL;
+	while ((ctx.rtt.count < ctx.sent) && (util_now_ns() < deadline)
+	       && !stop_acc)
+		usleep(1000);
+
+	ctx.done = 1;
+	pthread_join(receiver, NULL);
+
+	ping_print_stats(&ctx);
+	ret = 0;
+
+end:
+	if (acc->simulate)
+		sim_close(acc);
+	return ret;
+}
+
+/*
+ * Reference echo peer for a Linux USB gadget running the f_accessory
+ * function: every transfer read from the accessory device node is
+ * written back unchanged.
+ */
+int ping_echo(const char *path)
+{
+	unsigned char buf[PING_MAX_SIZE];
+	unsigned long echoed = 0;
+	ssize_t len;
+	int fd;
+
+	fd = open(path, O_RDWR);
+	if (fd < 0) {
+		printf("Unable to open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	printf("Echoing accessory transfers on %s\n", path);
+	while (!stop_acc) {
+		len = read(fd, buf, sizeof(buf));
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			printf("Error reading %s: %s\n", path, strerror(errno));
+			break;
+		}
+		if (write(fd, buf, len) != len) {
+			printf("Error writing %s: %s\n", path, strerror(errno));
+			break;
+		}
+		echoed++;
+	}
+
+	printf("Echoed %lu transfers\n", echoed);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Linux ADK - ping.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _PING_H_
+#define _PING_H_
+
+/*
+ * Probe format, little endian, padded with zeroes up to the probe size.
+ * The peer sends every probe back unchanged.
+ *
+ *   0  magic  u32  PING_MAGIC
+ *   4  seq    u32
+ *   8  tx_ns  u64  host CLOCK_MONOTONIC at send time
+ *  16  size   u32  total probe size
+ *  20  pad    u32
+ */
+#define PING_MAGIC		0x504b4441	/* "ADKP" */
+#define PING_HDR_SIZE		24
+#define PING_MAX_SIZE		16384	/* f_accessory buffer size */
+
+#define PING_DEFAULT_SIZE	64
+#define PING_DEFAULT_RATE	100	/* probes/s */
+#define PING_DRAIN_MS		1000	/* wait for late echoes */
+
+#define PING_ECHO_DEVICE	"/dev/usb_accessory"
+
+/* Functions */
+extern int ping_accessory(accessory_t *acc);
+extern int ping_echo(const char *path);
+
+#endif /* _PING_H_ */
@@ -0,0 +1,285 @@
+/*
+ * Linux ADK - pool.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <libusb.h>
+
+#include "linux-adk.h"
+#include "bulk.h"
+#include "pool.h"
+
+pool_t transfer_pool = {
+	.name = "transfer",
+	.transfers = 1,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+pool_t report_pool = {
+	.name = "report",
+	.size = POOL_REPORT_SIZE,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+pool_t bulk_pool = {
+	.name = "bulk",
+	.size = POOL_BULK_SIZE,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static int sealed;
+static int check;
+
+static int pool_init(pool_t *p, unsigned int count)
+{
+	unsigned int i;
+
+	p->free = calloc(count ? count : 1, sizeof(*p->free));
+	if (p->free == NULL)
+		goto error;
+
+	if (p->transfers) {
+		p->objs = calloc(count ? count : 1, sizeof(*p->objs));
+		if (p->objs == NULL)
+			goto error;
+		for (i = 0; i < count; i++) {
+			p->objs[i] = libusb_alloc_transfer(0);
+			if (p->objs[i] == NULL)
+				goto error;
+			p->count++;
+			p->free[i] = p->objs[i];
+		}
+	} else {
+		p->slab = malloc((size_t)count * p->size + 1);
+		if (p->slab == NULL)
+			goto error;
+		p->count = count;
+		for (i = 0; i < count; i++)
+			p->free[i] = p->slab + (size_t)i * p->size;
+	}
+
+	p->nfree = p->low = count;
+	return 0;
+
+error:
+	printf("failed to allocate %u blocks for the %s pool\n", count,
+	       p->name);
+	return -1;
+}
+
+static void pool_destroy(pool_t *p)
+{
+	unsigned int i;
+
+	if (p->transfers && p->objs)
+		for (i = 0; i < p->count; i++)
+			libusb_free_transfer(p->objs[i]);
+
+	free(p->objs);
+	free(p->slab);
+	free(p->free);
+	p->objs = NULL;
+	p->slab = NULL;
+	p->free = NULL;
+	p->count = p->nfree = p->low = 0;
+}
+
+/* Pools are sized from the configuration, before the handshake */
+int pools_init(accessory_t *acc)
+{
+	unsigned int depth = acc->queue_depth;
+	unsigned int bulk = acc->pool_buffers;
+
+	if (!depth)
+		depth = BULK_AUTO_MAX_QUEUE_DEPTH;
+	if (depth > BULK_MAX_QUEUE_DEPTH)
+		depth = BULK_MAX_QUEUE_DEPTH;
+	if (!bulk)
+		bulk = POOL_DEFAULT_BULK_COUNT;
+
+	if ((pool_init(&transfer_pool, depth + POOL_CONTROL_TRANSFERS) < 0)
+	    || (pool_init(&report_pool, POOL_REPORT_COUNT) < 0)
+	    || (pool_init(&bulk_pool, bulk) < 0)) {
+		pools_fini();
+		return -1;
+	}
+
+	return 0;
+}
+
+void pools_fini(void)
+{
+	pool_destroy(&transfer_pool);
+	pool_destroy(&report_pool);
+	pool_destroy(&bulk_pool);
+}
+
+/* Abort on heap allocations after the seal instead of counting them */
+void pool_set_check(int check_mode)
+{
+	check = check_mode;
+}
+
+/* Steady state from now on: every heap allocation is counted */
+void pool_seal(void)
+{
+	sealed = 1;
+}
+
+#ifdef POOL_WRAP_ALLOC
+
+static unsigned long heap_allocs;
+
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t nmemb, size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
+
+static void heap_alloc(const char *fn)
+{
+	if (!sealed)
+		return;
+
+	__sync_fetch_and_add(&heap_allocs, 1);
+	if (check) {
+		fprintf(stderr, "%s() in steady state\n", fn);
+		abort();
+	}
+}
+
+void *__wrap_malloc(size_t size)
+{
+	heap_alloc("malloc");
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	heap_alloc("calloc");
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	heap_alloc("realloc");
+	return __real_realloc(ptr, size);
+}
+
+/* Pool fallbacks are already counted per pool, not as stray allocations */
+#define pool_heap_alloc(size)	__real_malloc(size)
+
+#else
+
+#define pool_heap_alloc(size)	malloc(size)
+
+#endif /* POOL_WRAP_ALLOC */
+
+static void pool_print(const pool_t *p)
+{
+	printf("  %-8s %4u blocks, %6lu gets, %4u free at worst, "
+	       "%lu from heap\n", p->name, p->count, p->gets, p->low, p->heap);
+}
+
+void pools_print_stats(void)
+{
+	printf("Pools (%lu heap fallbacks):\n",
+	       transfer_pool.heap + report_pool.heap + bulk_pool.heap);
+#ifdef POOL_WRAP_ALLOC
+	printf("Heap allocations after the seal: %lu\n", heap_allocs);
+#else
+	printf("Heap allocations after the seal: not counted in this build\n");
+#endif
+	pool_print(&transfer_pool);
+	pool_print(&report_pool);
+	pool_print(&bulk_pool);
+}
+
+/* Take a block if one is free, never touches the heap */
+void *pool_try_get(pool_t *p)
+{
+	void *block = NULL;
+
+	pthread_mutex_lock(&p->lock);
+	p->gets++;
+	if (p->nfree) {
+		block = p->free[--p->nfree];
+		if (p->nfree < p->low)
+			p->low = p->nfree;
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return block;
+}
+
+void *pool_get(pool_t *p)
+{
+	void *block = pool_try_get(p);
+
+	if (block)
+		return block;
+
+	pthread_mutex_lock(&p->lock);
+	p->heap++;
+	pthread_mutex_unlock(&p->lock);
+
+	/* Pool too small for the configuration: fall back to the heap */
+	if (sealed && check) {
+		printf("%s pool exhausted, heap allocation in steady state\n",
+		       p->name);
+		abort();
+	}
+
+	return p->transfers ? (void *)libusb_alloc_transfer(0)
+	    : pool_heap_alloc(p->size);
+}
+
+static int pool_owns(const pool_t *p, const void *block)
+{
+	const unsigned char *b = block;
+	unsigned int i;
+
+	if (!p->transfers)
+		return p->slab && (b >= p->slab)
+		    && (b < p->slab + (size_t)p->count * p->size);
+
+	for (i = 0; i < p->count; i++)
+		if (p->objs[i] == block)
+			return 1;
+	return 0;
+}
+
+void pool_put(pool_t *p, void *block)
+{
+	if (block == NULL)
+		return;
+
+	if (!pool_owns(p, block)) {
+		if (p->transfers)
+			libusb_free_transfer(block);
+		else
+			free(block);
+		return;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->free[p->nfree++] = block;
+	pthread_mutex_unlock(&p->lock);
+}
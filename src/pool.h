@@ -0,0 +1,74 @@
+/*
+ * Linux ADK - pool.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <pthread.h>
+
+/*
+ * Fixed-size block pools
+ *
+ * All transfers and buffers used once the accessory is up come from these
+ * pools, which are sized from the command line in pools_init(). When a
+ * pool runs dry the block is taken from the heap instead and counted.
+ *
+ * Each mode calls pool_seal() once its threads are running, as thread
+ * stacks come from libc and cannot be accounted for. When built with
+ * POOL_WRAP_ALLOC (the Makefile links with --wrap=malloc,calloc,realloc),
+ * every allocation made by the program's own code after the seal is
+ * counted as well. With --alloc-check either one aborts.
+ */
+#define POOL_REPORT_SIZE	64	/* control setup + HID report */
+#define POOL_REPORT_COUNT	8
+#define POOL_BULK_SIZE		16384
+#define POOL_DEFAULT_BULK_COUNT	32
+#define POOL_CONTROL_TRANSFERS	4	/* on top of the bulk queue depth */
+
+typedef struct _pool_t {
+	const char *name;
+	int transfers;		/* blocks are libusb transfers */
+	size_t size;		/* buffer block size */
+	unsigned int count;
+	unsigned char *slab;	/* buffer pools */
+	void **objs;		/* transfer pools */
+	void **free;		/* stack of free blocks */
+	unsigned int nfree;
+	unsigned int low;	/* smallest nfree seen */
+	unsigned long gets;
+	unsigned long heap;	/* blocks that had to come from the heap */
+	pthread_mutex_t lock;
+} pool_t;
+
+extern pool_t transfer_pool;
+extern pool_t report_pool;
+extern pool_t bulk_pool;
+
+/* Functions */
+extern int pools_init(accessory_t *acc);
+extern void pools_fini(void);
+extern void pools_print_stats(void);
+extern void pool_set_check(int check);
+extern void pool_seal(void);
+extern void *pool_get(pool_t *p);
+extern void *pool_try_get(pool_t *p);
+extern void pool_put(pool_t *p, void *block);
+
+#endif /* _POOL_H_ */
@@ -0,0 +1,136 @@
+/*
+ * Linux ADK - rt.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include "linux-adk.h"
+#include "rt.h"
+
+#ifndef _WIN32
+
+/* Fault the stack in now, mlockall() then keeps it resident */
+static void rt_prefault_stack(void)
+{
+	volatile unsigned char stack[RT_PREFAULT_STACK];
+
+	memset((unsigned char *)stack, 0, sizeof(stack));
+}
+
+int rt_enter(accessory_t *acc)
+{
+	struct sched_param param;
+	cpu_set_t cpus;
+	int min, max;
+	int ret;
+
+	if (acc->rt_cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(acc->rt_cpu, &cpus);
+		ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus),
+					     &cpus);
+		if (ret != 0) {
+			printf("Unable to pin to CPU %d: %s\n", acc->rt_cpu,
+			       strerror(ret));
+			return -1;
+		}
+	}
+
+	if (!acc->rt_priority) {
+		if (acc->rt_cpu >= 0)
+			printf("Pinned to CPU %d\n", acc->rt_cpu);
+		return 0;
+	}
+
+	/* MCL_FUTURE would lock the file mapping, however large */
+	if (acc->push_file || acc->pull_file) {
+		printf("--rt-priority cannot be used with --push or --pull\n");
+		return -1;
+	}
+
+	min = sched_get_priority_min(SCHED_FIFO);
+	max = sched_get_priority_max(SCHED_FIFO);
+	if ((acc->rt_priority < min) || (acc->rt_priority > max)) {
+		printf("SCHED_FIFO priority must be between %d and %d\n", min,
+		       max);
+		return -1;
+	}
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		printf("Unable to lock memory: %s\n", strerror(errno));
+		return -1;
+	}
+	rt_prefault_stack();
+
+	param.sched_priority = acc->rt_priority;
+	ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret != 0) {
+		printf("Unable to switch to SCHED_FIFO priority %d: %s\n",
+		       acc->rt_priority, strerror(ret));
+		munlockall();
+		return -1;
+	}
+
+	if (acc->rt_cpu >= 0)
+		printf("Real-time mode: SCHED_FIFO priority %d on CPU %d, "
+		       "memory locked\n", acc->rt_priority, acc->rt_cpu);
+	else
+		printf("Real-time mode: SCHED_FIFO priority %d, memory "
+		       "locked\n", acc->rt_priority);
+	return 0;
+}
+
+#else /* _WIN32 */
+
+int rt_enter(accessory_t *acc)
+{
+	if (acc->rt_priority || (acc->rt_cpu >= 0)) {
+		printf("Real-time mode is not supported on this platform\n");
+		return -1;
+	}
+	return 0;
+}
+
+#endif /* _WIN32 */
+
+/* Default thread stacks are megabytes, all of it locked by MCL_FUTURE */
+int rt_thread_create(pthread_t *thread, void *(*fn)(void *), void *arg)
+{
+	pthread_attr_t attr;
+	int ret;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, RT_THREAD_STACK);
+	ret = pthread_create(thread, &attr, fn, arg);
+	pthread_attr_destroy(&attr);
+
+	return ret;
+}
@@ -0,0 +1,42 @@
+/*
+ * Linux ADK - rt.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _RT_H_
+#define _RT_H_
+
+#include <pthread.h>
+
+/*
+ * Opt-in real-time mode for the thread submitting USB transfers and
+ * handling their completions: SCHED_FIFO at --rt-priority, pinned to
+ * --cpu, with all memory locked so the report path does not page fault.
+ * Threads started afterwards inherit the policy and the CPU, and get a
+ * small stack so that locking it stays cheap. File transfers are refused:
+ * their whole mapping would be locked.
+ */
+#define RT_PREFAULT_STACK	(64 * 1024)
+#define RT_THREAD_STACK		(256 * 1024)
+
+/* Functions */
+extern int rt_enter(accessory_t *acc);
+extern int rt_thread_create(pthread_t *thread, void *(*fn)(void *),
+			    void *arg);
+
+#endif /* _RT_H_ */
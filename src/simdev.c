@@ -0,0 +1,155 @@
+/*
+ * Linux ADK - simdev.c
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#include <libusb.h>
+
+#include "linux-adk.h"
+#include "simdev.h"
+#include "pool.h"
+#include "util.h"
+
+/* There is only ever one simulated device, and it must not be allocated */
+static sim_dev_t sim_dev;
+
+int sim_open(accessory_t *acc, sim_peer_fn peer, void *peer_data)
+{
+	sim_dev_t *sim = &sim_dev;
+
+	memset(sim, 0, sizeof(*sim));
+	pthread_mutex_init(&sim->lock, NULL);
+	pthread_cond_init(&sim->cond, NULL);
+	sim->peer = peer;
+	sim->peer_data = peer_data;
+
+	acc->sim = sim;
+	printf("Using simulated accessory device\n");
+	return 0;
+}
+
+void sim_close(accessory_t *acc)
+{
+	sim_dev_t *sim = acc->sim;
+
+	if (sim == NULL)
+		return;
+
+	while (sim->count) {
+		pool_put(&bulk_pool, sim->queue[sim->head].data);
+		sim->head = (sim->head + 1) % SIM_QUEUE_LEN;
+		sim->count--;
+	}
+	pthread_cond_destroy(&sim->cond);
+	pthread_mutex_destroy(&sim->lock);
+	acc->sim = NULL;
+}
+
+/* Host OUT transfer: the peer sees it synchronously */
+int sim_write(sim_dev_t *sim, const void *buf, int len)
+{
+	if ((size_t)len > bulk_pool.size)
+		return LIBUSB_ERROR_OVERFLOW;
+
+	if (sim->peer)
+		sim->peer(sim, buf, len);
+
+	return len;
+}
+
+/* Host IN transfer: one queued answer per call, like a short packet */
+int sim_read(sim_dev_t *sim, void *buf, int len, unsigned int timeout)
+{
+	struct timespec deadline;
+	struct sim_pkt pkt;
+	int ret = 0;
+
+	util_deadline(&deadline, timeout);
+
+	pthread_mutex_lock(&sim->lock);
+	while (!sim->count && (ret != ETIMEDOUT)) {
+		if (timeout)
+			ret = pthread_cond_timedwait(&sim->cond, &sim->lock,
+						     &deadline);
+		else
+			pthread_cond_wait(&sim->cond, &sim->lock);
+	}
+	if (!sim->count) {
+		pthread_mutex_unlock(&sim->lock);
+		return LIBUSB_ERROR_TIMEOUT;
+	}
+
+	pkt = sim->queue[sim->head];
+	sim->head = (sim->head + 1) % SIM_QUEUE_LEN;
+	sim->count--;
+	pthread_mutex_unlock(&sim->lock);
+
+	if (pkt.len > len) {
+		pool_put(&bulk_pool, pkt.data);
+		return LIBUSB_ERROR_OVERFLOW;
+	}
+
+	memcpy(buf, pkt.data, pkt.len);
+	pool_put(&bulk_pool, pkt.data);
+	return pkt.len;
+}
+
+/* Queue an answer on the IN endpoint, dropped if the device is out of room */
+int sim_reply(sim_dev_t *sim, const void *buf, int len)
+{
+	struct sim_pkt pkt;
+
+	if ((size_t)len > bulk_pool.size)
+		return LIBUSB_ERROR_OVERFLOW;
+
+	pkt.len = len;
+	pkt.data = pool_try_get(&bulk_pool);
+	if (pkt.data == NULL) {
+		pthread_mutex_lock(&sim->lock);
+		sim->dropped++;
+		pthread_mutex_unlock(&sim->lock);
+		return LIBUSB_ERROR_BUSY;
+	}
+	memcpy(pkt.data, buf, len);
+
+	pthread_mutex_lock(&sim->lock);
+	if (sim->count == SIM_QUEUE_LEN) {
+		sim->dropped++;
+		pthread_mutex_unlock(&sim->lock);
+		pool_put(&bulk_pool, pkt.data);
+		return LIBUSB_ERROR_BUSY;
+	}
+	sim->queue[(sim->head + sim->count) % SIM_QUEUE_LEN] = pkt;
+	sim->count++;
+	pthread_cond_signal(&sim->cond);
+	pthread_mutex_unlock(&sim->lock);
+
+	return len;
+}
+
+/* Reference echo peer: every OUT transfer comes back on IN unchanged */
+void sim_echo_peer(sim_dev_t *sim, const unsigned char *buf, int len)
+{
+	sim_reply(sim, buf, len);
+}
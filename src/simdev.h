@@ -0,0 +1,66 @@
+/*
+ * Linux ADK - simdev.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _SIMDEV_H_
+#define _SIMDEV_H_
+
+#include <pthread.h>
+
+/*
+ * Simulated accessory device
+ *
+ * Stands in for the phone when no hardware is around (--simulate). Every
+ * transfer the host writes to the OUT endpoint is handed to a peer
+ * callback, which answers through sim_reply(); bulk_read() then returns
+ * the answers one transfer at a time, like the IN endpoint would. Answers
+ * are held in bulk pool buffers, so transfers are limited to their size.
+ */
+#define SIM_QUEUE_LEN		256
+
+struct _sim_dev_t;
+
+typedef void (*sim_peer_fn)(struct _sim_dev_t *sim, const unsigned char *buf,
+			    int len);
+
+struct sim_pkt {
+	int len;
+	unsigned char *data;
+};
+
+typedef struct _sim_dev_t {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	sim_peer_fn peer;
+	void *peer_data;
+	struct sim_pkt queue[SIM_QUEUE_LEN];	/* IN endpoint */
+	int head;
+	int count;
+	unsigned long dropped;
+} sim_dev_t;
+
+/* Functions */
+extern int sim_open(accessory_t *acc, sim_peer_fn peer, void *peer_data);
+extern void sim_close(accessory_t *acc);
+extern int sim_write(sim_dev_t *sim, const void *buf, int len);
+extern int sim_read(sim_dev_t *sim, void *buf, int len, unsigned int timeout);
+extern int sim_reply(sim_dev_t *sim, const void *buf, int len);
+extern void sim_echo_peer(sim_dev_t *sim, const unsigned char *buf, int len);
+
+#endif /* _SIMDEV_H_ */
@@ -0,0 +1,43 @@
+/*
+ * Linux ADK - util.h
+ *
+ * Copyright (C) 2026 - The linux-adk contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _UTIL_H_
+#define _UTIL_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/* Little-endian wire format, shared by the file, ping and mux framings */
+extern void put_le16(unsigned char *p, uint16_t v);
+extern void put_le32(unsigned char *p, uint32_t v);
+extern void put_le64(unsigned char *p, uint64_t v);
+extern uint16_t get_le16(const unsigned char *p);
+extern uint32_t get_le32(const unsigned char *p);
+extern uint64_t get_le64(const unsigned char *p);
+
+/* CLOCK_MONOTONIC, in ns or s */
+extern uint64_t util_now_ns(void);
+extern double util_now(void);
+/* Absolute monotonic sleep, returns early on stop_acc */
+extern void util_sleep_until_ns(uint64_t t);
+/* CLOCK_REALTIME deadline ms from now, for pthread_cond_timedwait() */
+extern void util_deadline(struct timespec *ts, unsigned int ms);
+
+#endif /* _UTIL_H_ */